@@ -27,7 +27,7 @@ sudo apt install -y --no-install-recommends \
     libopencv-dev \
     libarrow-dev libparquet-dev \
     nlohmann-json3-dev \
-    libgtest-dev \
+    libgtest-dev libbenchmark-dev \
     wget unzip ca-certificates || \
     echo "Some packages failed (usually due to unrelated PPAs – this is harmless)"
 
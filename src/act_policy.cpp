@@ -1,17 +1,28 @@
 #include "act_policy.h"
+#include "profiler.h"
+#include <ATen/autocast_mode.h>
+#include <algorithm>
+#include <cmath>
 
-ACTPolicyImpl::ACTPolicyImpl(int state_dim, int action_dim, int hidden)
-    : hidden_dim(hidden) {
+static constexpr int64_t IMAGE_TOKENS = 49;  // 7x7 pooled feature map
+
+ACTPolicyImpl::ACTPolicyImpl(int state_dim, int action_dim, int hidden, int max_history,
+                             int chunk_size)
+    : hidden_dim(hidden), max_history(max_history), chunk_size(chunk_size) {
     conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(3, 64, 7).stride(4)));
     conv2 = register_module("conv2", torch::nn::Conv2d(torch::nn::Conv2dOptions(64, 128, 5).stride(2)));
     conv3 = register_module("conv3", torch::nn::Conv2d(torch::nn::Conv2dOptions(128, hidden, 3).stride(2)));
     
     state_proj = register_module("state_proj", torch::nn::Linear(state_dim, hidden));
     head = register_module("head", torch::nn::Linear(hidden, action_dim));
+    pos_embed = register_parameter("pos_embed", torch::randn({IMAGE_TOKENS, hidden}) * 0.02);
+    time_embed = register_parameter("time_embed", torch::randn({max_history, hidden}) * 0.02);
+    query_embed = register_parameter("query_embed", torch::randn({chunk_size, hidden}) * 0.02);
 
-    auto layer = torch::nn::TransformerEncoderLayer(
-        torch::nn::TransformerEncoderLayerOptions(hidden, 8).dropout(0.1));
-    encoder = register_module("encoder", torch::nn::TransformerEncoder(layer, 4));
+    encoder = register_module("encoder", FusedEncoder(hidden, 8, 4, 2048, 0.1));
+    auto dec_layer = torch::nn::TransformerDecoderLayer(
+        torch::nn::TransformerDecoderLayerOptions(hidden, 8).dropout(0.1));
+    decoder = register_module("decoder", torch::nn::TransformerDecoder(dec_layer, 2));
 
     // Safe initialization
     float scale = std::sqrt(1.0f / std::max(state_dim, 1));
@@ -21,33 +32,321 @@ ACTPolicyImpl::ACTPolicyImpl(int state_dim, int action_dim, int hidden)
     torch::nn::init::constant_(head->bias, 0);
 }
 
-torch::Tensor ACTPolicyImpl::forward(const std::vector<cv::Mat>& images,
-                                     const torch::Tensor& state) {
-    torch::Tensor img_tokens;
+// One conv pass over every frame of the batch; uint8 -> float happens once here
+torch::Tensor ACTPolicyImpl::backbone(const torch::Tensor& frames) {
+    PROFILE_SCOPE("policy.backbone");
+    auto x = frames.to(torch::kFloat32).div_(255.0);
+    x = torch::relu(conv1(x));
+    x = torch::relu(conv2(x));
+    x = torch::relu(conv3(x));  // hidden_dim channels
+    x = torch::adaptive_avg_pool2d(x, {7, 7});
+    return x.flatten(2).transpose(1, 2);  // [N, 49, hidden_dim]
+}
+
+std::vector<torch::Tensor> ACTPolicyImpl::backbone_parameters() {
+    return {conv1->weight, conv1->bias, conv2->weight, conv2->bias, conv3->weight, conv3->bias};
+}
+
+uint64_t ACTPolicyImpl::backbone_fingerprint() {
+    uint64_t h = 1469598103934665603ull;
+    auto add = [&](const void* data, size_t n) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    };
+    for (const auto& p : backbone_parameters()) {
+        auto c = p.detach().to(torch::kFloat32).contiguous();
+        for (int64_t d : c.sizes()) add(&d, sizeof(d));
+        add(c.data_ptr(), c.nbytes());
+    }
+    return h;
+}
+
+void ACTPolicyImpl::load_backbone(const std::string& checkpoint) {
+    torch::serialize::InputArchive archive;
+    archive.load_from(checkpoint);
+    torch::NoGradGuard no_grad;
+    const std::pair<const char*, torch::nn::Conv2d> convs[] = {{"conv1", conv1}, {"conv2", conv2}, {"conv3", conv3}};
+    for (const auto& [name, conv] : convs) {
+        torch::Tensor weight, bias;
+        archive.read(std::string(name) + ".weight", weight);
+        archive.read(std::string(name) + ".bias", bias);
+        if (weight.sizes() != conv->weight.sizes())
+            throw std::runtime_error("Backbone " + std::string(name) + " in " + checkpoint + " has shape " +
+                                     c10::str(weight.sizes()) + ", expected " + c10::str(conv->weight.sizes()));
+        conv->weight.copy_(weight);
+        conv->bias.copy_(bias);
+    }
+}
+
+torch::Tensor ACTPolicyImpl::forward(const torch::Tensor& images, const torch::Tensor& state,
+                                     const torch::Tensor& image_mask) {
+    PROFILE_SCOPE("policy.forward");
+    if (!images.defined()) {
+        auto zeros = torch::zeros({state.size(0), 1, IMAGE_TOKENS, hidden_dim}, state.options());
+        return forward_tokens(zeros, state);
+    }
+    const int64_t B = images.size(0), T = images.size(1);
+    return forward_tokens(backbone(images.flatten(0, 1)).view({B, T, IMAGE_TOKENS, hidden_dim}), state, image_mask);
+}
+
+torch::Tensor ACTPolicyImpl::forward_tokens(const torch::Tensor& image_tokens, const torch::Tensor& state,
+                                            const torch::Tensor& image_mask) {
+    const int64_t B = state.size(0);
+    const int64_t T = image_tokens.size(1);
+    if (T > max_history)
+        throw std::invalid_argument("ACTPolicy: " + std::to_string(T) + " history frames, max_history is " +
+                                    std::to_string(max_history));
+
+    // --- Image tokens [B, T*49, hidden] with spatial + temporal embeddings ---
+    // the newest frame always uses the last time slot, so T can vary
+    auto time = time_embed.slice(0, max_history - T).view({1, T, 1, hidden_dim});
+    auto img_tokens = (image_tokens + pos_embed.view({1, 1, IMAGE_TOKENS, hidden_dim}) + time)
+                          .view({B, T * IMAGE_TOKENS, hidden_dim});
+
+    auto state_token = state_proj(state).unsqueeze(1);  // [B, 1, hidden_dim]
+
+    auto seq = torch::cat({img_tokens, state_token}, 1);  // [B, L, hidden_dim], encoder is batch-first
+
+    // padded history frames are hidden from attention
+    torch::Tensor padding;
+    if (image_mask.defined()) {
+        padding = (~image_mask.to(torch::kBool)).repeat_interleave(IMAGE_TOKENS, 1);
+        padding = torch::cat({padding, torch::zeros({B, 1}, padding.options())}, 1);
+    }
+
+    torch::Tensor memory;
+    {
+        PROFILE_SCOPE("policy.encoder");
+        memory = encoder(seq, padding).transpose(0, 1);  // [L, B, hidden_dim], decoder is seq-first
+    }
+
+    // --- Chunk decoding: queries attend to each other and to the memory ---
+    PROFILE_SCOPE("policy.decoder");
+    auto queries = query_embed.unsqueeze(1).expand({chunk_size, B, hidden_dim});
+    auto decoded = decoder(queries, memory, /*tgt_mask=*/{}, /*memory_mask=*/{},
+                           /*tgt_key_padding_mask=*/{}, padding);
+    return head(decoded).transpose(0, 1);  // [B, chunk_size, action_dim]
+}
+
+torch::Tensor ACTPolicyImpl::forward(const std::vector<cv::Mat>& images, const torch::Tensor& state) {
+    torch::Tensor frames;
+    if (std::any_of(images.begin(), images.end(), [](const cv::Mat& m) { return !m.empty(); }))
+        frames = mats_to_tensor(images).unsqueeze(0);
+    return forward(frames, state.unsqueeze(0)).squeeze(0);
+}
 
-    if (!images.empty() && !images.back().empty()) {
-        auto& img = images.back();
-        auto x = torch::from_blob(img.data, {img.rows, img.cols, 3}, torch::kUInt8)
-                     .to(torch::kFloat32) / 255.0;
-        x = x.permute({2, 0, 1}).unsqueeze(0);
+torch::Tensor mats_to_tensor(const std::vector<cv::Mat>& images) {
+    int rows = 0, cols = 0;
+    for (const auto& img : images) {
+        if (img.empty()) continue;
+        rows = img.rows;
+        cols = img.cols;
+    }
+    auto out = torch::zeros({int64_t(images.size()), rows, cols, 3}, torch::kUInt8);
+    for (size_t t = 0; t < images.size(); ++t) {
+        const auto& img = images[t];
+        if (img.empty() || img.rows != rows || img.cols != cols || img.type() != CV_8UC3) continue;
+        cv::Mat dst(rows, cols, CV_8UC3, out[t].data_ptr<uint8_t>());
+        img.copyTo(dst);
+    }
+    return out.permute({0, 3, 1, 2});
+}
+
+// --- ACTConfig ---
+
+ACTPolicy ACTConfig::make_policy() const {
+    return ACTPolicy(state_dim, action_dim, hidden_dim, max_history, chunk_size);
+}
+
+static std::vector<float> to_floats(const torch::Tensor& t) {
+    auto c = t.to(torch::kFloat32).contiguous();
+    return std::vector<float>(c.data_ptr<float>(), c.data_ptr<float>() + c.numel());
+}
 
-        x = torch::relu(conv1(x));
-        x = torch::relu(conv2(x));
-        x = torch::relu(conv3(x));  // ← now outputs hidden_dim channels
-        x = torch::adaptive_avg_pool2d(x, {7, 7});
-        x = x.flatten(2).transpose(1, 2);
-        img_tokens = x.squeeze(0);  // [49, hidden_dim]
+void ACTConfig::save(const fs::path& path) const {
+    nlohmann::json j;
+    j["state_dim"] = state_dim;
+    j["action_dim"] = action_dim;
+    j["hidden_dim"] = hidden_dim;
+    j["max_history"] = max_history;
+    j["chunk_size"] = chunk_size;
+    j["image_deltas"] = image_deltas;
+    j["action_deltas"] = action_deltas;
+    j["train_frames"] = train_frames;
+    j["state_mean"] = to_floats(state_mean);
+    j["state_std"] = to_floats(state_std);
+    j["action_mean"] = to_floats(action_mean);
+    j["action_std"] = to_floats(action_std);
+    std::ofstream f(path);
+    f << j.dump(2) << std::endl;
+}
+
+ACTConfig ACTConfig::load(const fs::path& path) {
+    std::ifstream f(path);
+    if (!f) throw std::runtime_error("Cannot open policy config " + path.string());
+    auto j = nlohmann::json::parse(f);
+    ACTConfig c;
+    c.state_dim = j.at("state_dim").get<int>();
+    c.action_dim = j.at("action_dim").get<int>();
+    c.hidden_dim = j.at("hidden_dim").get<int>();
+    c.max_history = j.at("max_history").get<int>();
+    c.chunk_size = j.at("chunk_size").get<int>();
+    c.image_deltas = j.at("image_deltas").get<std::vector<float>>();
+    c.action_deltas = j.value("action_deltas", c.action_deltas);
+    c.train_frames = j.value("train_frames", size_t(0));
+    auto tensor = [&](const char* key) { return torch::tensor(j.at(key).get<std::vector<float>>()); };
+    c.state_mean = tensor("state_mean");
+    c.state_std = tensor("state_std");
+    c.action_mean = tensor("action_mean");
+    c.action_std = tensor("action_std");
+    return c;
+}
+
+torch::Tensor chunk_loss(const torch::Tensor& pred, const torch::Tensor& target, const torch::Tensor& mask) {
+    auto err = (pred.to(torch::kFloat32) - target.to(torch::kFloat32)).pow(2);
+    if (!mask.defined()) return err.mean();
+    auto m = mask.to(err.dtype()).unsqueeze(-1);
+    return (err * m).sum() / (m.sum() * err.size(-1)).clamp_min(1.0);
+}
+
+// --- CpuAutocast ---
+
+CpuAutocast::CpuAutocast(bool enabled, at::ScalarType dtype) : enabled_(enabled) {
+    if (!enabled_) return;
+    prev_enabled_ = at::autocast::is_autocast_enabled(at::kCPU);
+    prev_dtype_ = at::autocast::get_autocast_dtype(at::kCPU);
+    at::autocast::set_autocast_enabled(at::kCPU, true);
+    at::autocast::set_autocast_dtype(at::kCPU, dtype);
+    at::autocast::increment_nesting();
+}
+
+CpuAutocast::~CpuAutocast() {
+    if (!enabled_) return;
+    // the outermost region drops the cached low-precision weight casts
+    if (at::autocast::decrement_nesting() == 0) at::autocast::clear_cache();
+    at::autocast::set_autocast_enabled(at::kCPU, prev_enabled_);
+    at::autocast::set_autocast_dtype(at::kCPU, prev_dtype_);
+}
+
+// --- ChunkExecutor ---
+
+ChunkExecutor::ChunkExecutor(int chunk_size, ChunkExecutorOptions options)
+    : chunk_size_(chunk_size), options_(options) {
+    if (options_.replan_stride < 1 || options_.replan_stride > chunk_size)
+        throw std::invalid_argument("ChunkExecutor: replan_stride must be in [1, chunk_size]");
+}
+
+bool ChunkExecutor::needs_plan() const {
+    return last_plan_ < 0 || tick_ - last_plan_ >= options_.replan_stride;
+}
+
+void ChunkExecutor::add_plan(const torch::Tensor& chunk) {
+    live_.push_back({tick_, chunk.detach().to(torch::kFloat32)});
+    last_plan_ = tick_;
+    ++plans_;
+}
+
+torch::Tensor ChunkExecutor::step() {
+    while (!live_.empty() && tick_ - live_.front().start >= chunk_size_) live_.pop_front();
+    if (live_.empty()) throw std::logic_error("ChunkExecutor: no plan covers tick " + std::to_string(tick_));
+
+    torch::Tensor action;
+    if (!options_.ensemble) {
+        const auto& newest = live_.back();
+        action = newest.chunk[tick_ - newest.start];
     } else {
-        img_tokens = torch::zeros({49, hidden_dim}, torch::kFloat32);
+        action = torch::zeros_like(live_.front().chunk[0]);
+        double total = 0.0;
+        for (size_t i = 0; i < live_.size(); ++i) {
+            double w = std::exp(-options_.ensemble_decay * i);
+            action += live_[i].chunk[tick_ - live_[i].start] * w;
+            total += w;
+        }
+        action /= total;
     }
+    ++tick_;
+    return action;
+}
+
+void ChunkExecutor::reset() {
+    live_.clear();
+    tick_ = 0;
+    last_plan_ = -1;
+}
+
+// --- StreamingPolicy ---
+
+StreamingPolicy::StreamingPolicy(ACTPolicy policy, std::vector<float> image_deltas, StreamingOptions options)
+    : policy_(std::move(policy)), deltas_(std::move(image_deltas)), options_(options) {
+    if (deltas_.empty()) deltas_ = {0.0f};
+    std::sort(deltas_.begin(), deltas_.end());
+    if (options_.fps <= 0) throw std::invalid_argument("StreamingPolicy: fps must be positive");
+    if (options_.capacity == 0)
+        options_.capacity = size_t(std::ceil(-std::min(deltas_.front(), 0.0f) * options_.fps)) + 2;
+    options_.capacity = std::max(options_.capacity, deltas_.size());
+    stamps_.resize(options_.capacity);
+}
+
+void StreamingPolicy::reset() {
+    next_ = size_ = 0;
+    ++stats_.resets;
+}
+
+size_t StreamingPolicy::nearest(double stamp) const {
+    size_t best = 0;
+    for (size_t i = 1; i < size_; ++i)
+        if (std::abs(stamps_[i] - stamp) < std::abs(stamps_[best] - stamp)) best = i;
+    return best;
+}
+
+void StreamingPolicy::observe(const torch::Tensor& image, double timestamp) {
+    PROFILE_SCOPE("policy.stream_observe");
+    const double tol = tolerance();
+    if (size_ > 0 && timestamp < stamps_[newest()] - tol) reset();  // clock went back: new episode
 
-    auto state_token = state_proj(state).unsqueeze(0);  // [1, hidden_dim]
+    if (size_ > 0 && std::abs(timestamp - stamps_[newest()]) <= tol) {
+        ++stats_.repeated;  // ticking faster than the camera
+        return;
+    }
+    if (!tokens_.defined()) tokens_ = torch::empty({int64_t(options_.capacity), IMAGE_TOKENS, policy_->hidden_dim});
+    if (size_ == 0) episode_start_ = timestamp;
+    else stats_.dropped += std::max<int64_t>(0, std::llround((timestamp - stamps_[newest()]) * options_.fps) - 1);
+    tokens_[next_].copy_(policy_->backbone(image.unsqueeze(0))[0]);
+    stamps_[next_] = timestamp;
+    next_ = (next_ + 1) % options_.capacity;
+    size_ = std::min(size_ + 1, options_.capacity);
+    ++stats_.encoded;
+}
 
-    auto seq = torch::cat({img_tokens, state_token}, 0);  // [50, hidden_dim]
-    seq = seq.unsqueeze(1);                               // [50, 1, hidden_dim]
+torch::Tensor StreamingPolicy::step(const torch::Tensor& image, double timestamp, const torch::Tensor& state) {
+    observe(image, timestamp);
+    return plan(state);
+}
 
-    auto encoded = encoder(seq);
-    encoded = encoded.squeeze(1);
+torch::Tensor StreamingPolicy::plan(const torch::Tensor& state) {
+    if (size_ == 0) throw std::logic_error("StreamingPolicy: plan() before any frame was observed");
+    PROFILE_SCOPE("policy.stream_plan");
+    const double tol = tolerance();
+    const double timestamp = stamps_[newest()];
 
-    return head(encoded.index({-1}));  // [action_dim]
+    // --- History from the ring, oldest delta first ---
+    const int64_t T = deltas_.size();
+    auto slots = torch::empty({T}, torch::kInt64);
+    auto mask = torch::ones({1, T}, torch::kBool);
+    auto* slot = slots.data_ptr<int64_t>();
+    auto real = mask.accessor<bool, 2>();
+    for (int64_t t = 0; t < T; ++t) {
+        const double want = timestamp + deltas_[t];
+        if (want < episode_start_ - tol) {
+            slot[t] = nearest(episode_start_);
+            real[0][t] = false;
+            ++stats_.padded;
+        } else {
+            slot[t] = nearest(want);
+            if (std::abs(stamps_[slot[t]] - want) > tol) ++stats_.substituted;
+        }
+    }
+    ++stats_.plans;
+    auto history = tokens_.index_select(0, slots).unsqueeze(0);  // [1, T, 49, hidden]
+    return policy_->forward_tokens(history, state.unsqueeze(0), mask)[0];
 }
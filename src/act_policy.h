@@ -2,16 +2,183 @@
 #include <torch/torch.h>
 #include <torch/nn/module.h>
 #include "dataset.h"
+#include "fused_encoder.h"
+#include <deque>
 
+// Action Chunking Transformer: the encoder reads image history + state
+// tokens, then chunk_size learned queries decode the next chunk_size actions
+// in one pass.
 struct ACTPolicyImpl : torch::nn::Module {
-    ACTPolicyImpl(int state_dim, int action_dim, int hidden = 256);
+    ACTPolicyImpl(int state_dim, int action_dim, int hidden = 256, int max_history = 8,
+                  int chunk_size = 1);
+
+    // images [B, T, 3, H, W] uint8 (oldest frame first), state [B, state_dim]
+    // normalized; image_mask [B, T] flags real (vs padded) frames and may be
+    // undefined. Returns [B, chunk_size, action_dim]. Undefined images stand
+    // in as zero tokens.
+    torch::Tensor forward(const torch::Tensor& images, const torch::Tensor& state,
+                          const torch::Tensor& image_mask = {});
+    // Single sample from HWC mats; returns [chunk_size, action_dim]
     torch::Tensor forward(const std::vector<cv::Mat>& images, const torch::Tensor& state);
 
+    // Transformer part of forward() on precomputed backbone tokens
+    // [B, T, 49, hidden] (see FeatureStore); image_mask as above.
+    // script_policy (policy_export.cpp) generates the same computation as
+    // TorchScript: a change here must be made there too (export_policy
+    // checks the two agree).
+    torch::Tensor forward_tokens(const torch::Tensor& image_tokens, const torch::Tensor& state,
+                                 const torch::Tensor& image_mask = {});
+
+    torch::Tensor backbone(const torch::Tensor& frames);  // [N, 3, H, W] uint8 -> [N, 49, hidden]
+    std::vector<torch::Tensor> backbone_parameters();     // conv1..conv3 weights and biases
+    // FNV-1a over the backbone parameters: equal fingerprints, equal tokens
+    uint64_t backbone_fingerprint();
+    // Copy conv1..conv3 out of a saved ACTPolicy checkpoint (other shapes may differ)
+    void load_backbone(const std::string& checkpoint);
+
     torch::nn::Conv2d conv1{nullptr}, conv2{nullptr}, conv3{nullptr};
     torch::nn::Linear state_proj{nullptr};
-    torch::nn::TransformerEncoder encoder{nullptr};
+    FusedEncoder encoder{nullptr};  // batch-first, parameters named as torch::nn::TransformerEncoder's
+    torch::nn::TransformerDecoder decoder{nullptr};
     torch::nn::Linear head{nullptr};
+    torch::Tensor pos_embed;   // [49, hidden], spatial position of an image token
+    torch::Tensor time_embed;  // [max_history, hidden], history slot, newest frame last
+    torch::Tensor query_embed; // [chunk_size, hidden], one query per future action
     int hidden_dim = 256;  // Store hidden dim
+    int max_history = 8;
+    int chunk_size = 1;
 };
 
 TORCH_MODULE(ACTPolicy);
+
+// Everything needed to rebuild a trained policy next to its weights; train
+// writes it as checkpoints/act_config.json. States are normalized as
+// (x - mean) / (std + 1e-5), predicted actions mapped back the same way.
+struct ACTConfig {
+    int state_dim = 2;
+    int action_dim = 2;
+    int hidden_dim = 256;
+    int max_history = 8;
+    int chunk_size = 1;
+    std::vector<float> image_deltas{0.0f};  // history the policy was trained on, oldest first
+    std::vector<float> action_deltas{0.0f}; // chunk targets, seconds from the frame
+    size_t train_frames = 0;                // frames [0, train_frames) trained on, the rest held out
+    torch::Tensor state_mean, state_std, action_mean, action_std;  // [dim] float32
+
+    ACTPolicy make_policy() const;
+    void save(const fs::path& path) const;
+    static ACTConfig load(const fs::path& path);
+};
+
+// Masked MSE between a predicted chunk [B, k, A] and its targets; mask
+// [B, k] drops steps past the end of the episode (undefined = all valid).
+// Always computed in float32, whatever precision pred came out in.
+torch::Tensor chunk_loss(const torch::Tensor& pred, const torch::Tensor& target, const torch::Tensor& mask);
+
+// CPU autocast region for mixed-precision training: convs, linears and
+// matmuls run in dtype (bfloat16) on the fly while parameters, and so the
+// optimizer's master weights, stay float32; autocast keeps its fp32-list
+// ops (layer norm, softmax, losses) in float32. Wrap the forward only, not
+// backward or the optimizer step. A disabled guard is a no-op.
+class CpuAutocast {
+public:
+    explicit CpuAutocast(bool enabled = true, at::ScalarType dtype = at::kBFloat16);
+    ~CpuAutocast();
+    CpuAutocast(const CpuAutocast&) = delete;
+    CpuAutocast& operator=(const CpuAutocast&) = delete;
+
+private:
+    bool enabled_;
+    bool prev_enabled_ = false;
+    at::ScalarType prev_dtype_ = at::kBFloat16;
+};
+
+struct ChunkExecutorOptions {
+    int replan_stride = 1;        // control ticks between policy evaluations, 1..chunk_size
+    bool ensemble = true;         // average every live chunk instead of following the newest
+    double ensemble_decay = 0.01; // w_i = exp(-decay * i), i = 0 for the oldest prediction
+};
+
+// Turns predicted chunks into one action per control tick. The policy runs
+// only when needs_plan() is true, i.e. every replan_stride ticks, so it is
+// evaluated replan_stride times less often. With ensembling each tick
+// averages the predictions of all chunks still covering it, weighted
+// exponentially by age as in ACT's temporal ensembling, which smooths the
+// seams between chunks.
+class ChunkExecutor {
+public:
+    ChunkExecutor(int chunk_size, ChunkExecutorOptions options = {});
+
+    bool needs_plan() const;
+    void add_plan(const torch::Tensor& chunk);  // [chunk_size, action_dim] for the current tick onwards
+    torch::Tensor step();                       // action for the current tick, then advance
+    void reset();                               // new episode
+    int64_t plans() const { return plans_; }
+
+private:
+    struct Plan {
+        int64_t start;  // tick of chunk[0]
+        torch::Tensor chunk;
+    };
+    int chunk_size_;
+    ChunkExecutorOptions options_;
+    std::deque<Plan> live_;  // oldest first
+    int64_t tick_ = 0;
+    int64_t last_plan_ = -1;
+    int64_t plans_ = 0;
+};
+
+struct StreamingOptions {
+    double fps = 30.0;    // camera rate; stamps within half a period are the same frame
+    size_t capacity = 0;  // frames kept, 0 = enough to cover the oldest image delta
+};
+
+struct StreamingStats {
+    int64_t plans = 0;
+    int64_t encoded = 0;      // frames run through the backbone
+    int64_t repeated = 0;     // steps whose frame was already encoded
+    int64_t dropped = 0;      // frames missing from the stream, from gaps in the stamps
+    int64_t substituted = 0;  // history slots served by the nearest frame after a drop
+    int64_t padded = 0;       // history slots before the episode start, masked out
+    int64_t resets = 0;
+};
+
+// Tick-by-tick inference that runs the backbone once per camera frame.
+// Backbone tokens are kept in a ring keyed by capture time; each step
+// encodes only the new frame and assembles the history for image_deltas
+// from the ring, so the convolution cost per step does not grow with the
+// history length. History slots that fall before the episode start use the
+// first frame and are masked, as the dataset pads them in training; slots
+// whose frame was dropped use the nearest cached frame instead. A stamp
+// earlier than the previous one starts a new episode.
+class StreamingPolicy {
+public:
+    StreamingPolicy(ACTPolicy policy, std::vector<float> image_deltas, StreamingOptions options = {});
+
+    // Encode a frame [3, H, W] uint8 captured at timestamp (seconds). Call
+    // it for every frame, also on ticks that do not plan.
+    void observe(const torch::Tensor& image, double timestamp);
+    // Chunk for the newest observed frame: state [state_dim] normalized ->
+    // [chunk_size, action_dim] normalized
+    torch::Tensor plan(const torch::Tensor& state);
+    torch::Tensor step(const torch::Tensor& image, double timestamp, const torch::Tensor& state);  // both
+    void reset();  // new episode: forget every cached frame
+    const StreamingStats& stats() const { return stats_; }
+
+private:
+    ACTPolicy policy_;
+    std::vector<float> deltas_;  // oldest first
+    StreamingOptions options_;
+    torch::Tensor tokens_;        // [capacity, 49, hidden], allocated on the first step
+    std::vector<double> stamps_;  // capture time per ring slot
+    size_t next_ = 0, size_ = 0;  // next slot to write, slots in use
+    double episode_start_ = 0.0;
+    StreamingStats stats_;
+
+    double tolerance() const { return 0.5 / options_.fps; }
+    size_t newest() const { return (next_ + options_.capacity - 1) % options_.capacity; }
+    size_t nearest(double stamp) const;  // ring slot closest in time
+};
+
+// HWC uint8 mats -> [T, 3, H, W] uint8; empty mats become zeros
+torch::Tensor mats_to_tensor(const std::vector<cv::Mat>& images);
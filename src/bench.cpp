@@ -0,0 +1,248 @@
+#include "act_policy.h"
+#include "data_loader.h"
+#include "synthetic_dataset.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <random>
+
+// Usage: bench [--benchmark_filter=<regex>] [other Google Benchmark flags]
+// Hot paths of data loading and training. Runs on LEROBOT_BENCH_DATA if set,
+// otherwise on a synthetic dataset generated once under the temp directory
+// (LEROBOT_BENCH_EPISODES x LEROBOT_BENCH_FRAMES, default 20 x 200, 96x96).
+
+namespace {
+
+constexpr int CHUNK_SIZE = 16;
+constexpr double FPS = 10.0;
+
+int env_int(const char* name, int fallback) {
+    const char* v = std::getenv(name);
+    return v ? std::atoi(v) : fallback;
+}
+
+const fs::path& dataset_root() {
+    static const fs::path root = [] {
+        if (const char* path = std::getenv("LEROBOT_BENCH_DATA")) return fs::path(path);
+        SyntheticDatasetOptions o;
+        o.episodes = env_int("LEROBOT_BENCH_EPISODES", o.episodes);
+        o.frames_per_episode = env_int("LEROBOT_BENCH_FRAMES", o.frames_per_episode);
+        o.fps = FPS;
+        fs::path root = fs::temp_directory_path() /
+                        ("lerobot_bench_" + std::to_string(o.episodes) + "x" + std::to_string(o.frames_per_episode));
+        if (!fs::exists(root / "meta" / "info.json")) write_synthetic_dataset(root, o);
+        return root;
+    }();
+    return root;
+}
+
+std::map<std::string, std::vector<float>> train_deltas() {
+    std::vector<float> action;
+    for (int i = 0; i < CHUNK_SIZE; ++i) action.push_back(i / FPS);
+    return {{"observation.image", {-0.1f, 0.0f}}, {"action", action}};
+}
+
+// Shared, fully loaded dataset (manifest warm after the first construction)
+LeRobotDataset& dataset() {
+    static LeRobotDataset ds(dataset_root().string(), train_deltas());
+    return ds;
+}
+
+std::vector<size_t> random_indices(size_t n, size_t size, uint64_t seed = 0) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, size - 1);
+    std::vector<size_t> out(n);
+    for (auto& i : out) i = pick(rng);
+    return out;
+}
+
+// --- Dataset ---
+
+// arg 0: ColumnStorage; arg 1: 0 = manifest removed (full scan), 1 = warm
+void BM_DatasetConstruct(benchmark::State& state) {
+    const auto storage = static_cast<ColumnStorage>(state.range(0));
+    const bool warm = state.range(1);
+    const fs::path manifest = dataset_root() / DatasetManifest::FILE_NAME;
+    { LeRobotDataset warmup(dataset_root().string(), train_deltas(), "observation.state", "action", storage); }
+    for (auto _ : state) {
+        if (!warm) {
+            state.PauseTiming();
+            fs::remove(manifest);
+            state.ResumeTiming();
+        }
+        LeRobotDataset ds(dataset_root().string(), train_deltas(), "observation.state", "action", storage);
+        benchmark::DoNotOptimize(ds.size());
+    }
+}
+BENCHMARK(BM_DatasetConstruct)
+    ->ArgNames({"storage", "manifest"})
+    ->ArgsProduct({{int(ColumnStorage::Tables), int(ColumnStorage::Contiguous), int(ColumnStorage::Streaming)},
+                   {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+// arg: 0 = columns only, 1 = with image history (frame cache disabled)
+void BM_DatasetGet(benchmark::State& state) {
+    auto& ds = dataset();
+    const bool images = state.range(0);
+    ds.set_load_images(images);
+    ds.set_frame_cache_bytes(0);
+    auto indices = random_indices(4096, ds.size().value());
+    size_t i = 0;
+    for (auto _ : state) {
+        Frame f = ds.get(indices[i++ % indices.size()]);
+        benchmark::DoNotOptimize(f.state.data_ptr());
+    }
+    ds.set_load_images(true);
+    ds.set_frame_cache_bytes(size_t(512) << 20);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatasetGet)->ArgName("images")->Arg(0)->Arg(1);
+
+void BM_GetBatch(benchmark::State& state) {
+    auto& ds = dataset();
+    const int64_t B = state.range(0);
+    auto indices = torch::randint(0, int64_t(ds.size().value()), {B}, torch::kInt64);
+    for (auto _ : state) {
+        Batch b = ds.get_batch(indices);
+        benchmark::DoNotOptimize(b.action_chunk.data_ptr());
+    }
+    state.SetItemsProcessed(state.iterations() * B);
+}
+BENCHMARK(BM_GetBatch)->RangeMultiplier(8)->Range(1, 512);
+
+// --- Video decode ---
+
+// arg: 0 = sequential frames, 1 = uniformly random frames of one episode
+void BM_DecodeFrame(benchmark::State& state) {
+    const bool random = state.range(0);
+    fs::path video;
+    for (const auto& entry : fs::recursive_directory_iterator(dataset_root() / "videos"))
+        if (entry.path().extension() == ".mp4" && (video.empty() || entry.path() < video)) video = entry.path();
+    if (video.empty()) {
+        state.SkipWithError("dataset has no videos");
+        return;
+    }
+    VideoDecoder decoder(video.string());
+    const int frames = int(cv::VideoCapture(video.string()).get(cv::CAP_PROP_FRAME_COUNT));
+    if (!decoder.is_open() || frames <= 0) {
+        state.SkipWithError("cannot open " + video.string());
+        return;
+    }
+    auto targets = random_indices(4096, frames, 1);
+    size_t i = 0;
+    for (auto _ : state) {
+        int target = random ? int(targets[i % targets.size()]) : int(i % frames);
+        ++i;
+        cv::Mat m = decoder.read(target);
+        benchmark::DoNotOptimize(m.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["seeks/frame"] = double(decoder.stats().seeks) / std::max<int64_t>(1, state.iterations());
+}
+BENCHMARK(BM_DecodeFrame)->ArgName("random")->Arg(0)->Arg(1);
+
+// --- Normalization ---
+
+void BM_NormalizationStats(benchmark::State& state) {
+    auto states = dataset().states();
+    auto actions = dataset().actions();
+    for (auto _ : state) {
+        RunningStats s(states.size(1)), a(actions.size(1));
+        s.update(states);
+        a.update(actions);
+        benchmark::DoNotOptimize(s.stddev().data_ptr());
+    }
+    state.SetItemsProcessed(state.iterations() * states.size(0));
+}
+BENCHMARK(BM_NormalizationStats)->Unit(benchmark::kMillisecond);
+
+// --- Policy ---
+
+void BM_PolicyForward(benchmark::State& state) {
+    const int64_t B = state.range(0);
+    torch::manual_seed(0);
+    ACTPolicy policy(2, 2, 256, 8, CHUNK_SIZE);
+    policy->eval();
+    torch::InferenceMode inference_mode;
+    auto images = torch::randint(0, 256, {B, 2, 3, 96, 96}, torch::kUInt8);
+    auto s = torch::randn({B, 2});
+    for (auto _ : state) benchmark::DoNotOptimize(policy->forward(images, s).data_ptr());
+    state.SetItemsProcessed(state.iterations() * B);
+}
+BENCHMARK(BM_PolicyForward)->RangeMultiplier(4)->Range(1, 256)->Unit(benchmark::kMillisecond);
+
+// The policy's encoder (hidden 256, 8 heads, 4 layers, 50 tokens: one
+// frame + state) in eval mode. arg 0: 0 = torch::nn::TransformerEncoder,
+// seq-first, 1 = FusedEncoder with the same weights; "max_abs_diff" is the
+// largest deviation of the fused output from the generic one, and the run
+// fails above ENCODER_TOLERANCE.
+constexpr double ENCODER_TOLERANCE = 1e-4;
+
+void BM_Encoder(benchmark::State& state) {
+    const bool fused = state.range(0);
+    const int64_t B = state.range(1), L = 50, H = 256;
+    torch::manual_seed(0);
+    torch::nn::TransformerEncoder generic(
+        torch::nn::TransformerEncoderLayer(torch::nn::TransformerEncoderLayerOptions(H, 8).dropout(0.1)), 4);
+    FusedEncoder fast(H, 8, 4, 2048, 0.1);
+    {
+        torch::NoGradGuard no_grad;
+        auto dst = fast->named_parameters();
+        for (const auto& p : generic->named_parameters()) dst[p.key()].copy_(p.value());
+    }
+    generic->eval();
+    fast->eval();
+    torch::InferenceMode inference_mode;
+    auto x = torch::randn({B, L, H});
+    const double diff =
+        (fast->forward(x) - generic->forward(x.transpose(0, 1)).transpose(0, 1)).abs().max().item<double>();
+    state.counters["max_abs_diff"] = diff;
+    if (!(diff <= ENCODER_TOLERANCE)) {  // also catches NaN
+        state.SkipWithError("fused encoder differs from TransformerEncoder by " + std::to_string(diff));
+        return;
+    }
+    for (auto _ : state) {
+        auto out = fused ? fast->forward(x) : generic->forward(x.transpose(0, 1));
+        benchmark::DoNotOptimize(out.data_ptr());
+    }
+    state.SetItemsProcessed(state.iterations() * B);
+}
+BENCHMARK(BM_Encoder)
+    ->ArgNames({"fused", "B"})
+    ->ArgsProduct({{0, 1}, {1, 4, 16, 64, 256}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Gather B frames with image history, forward, chunk loss, backward,
+// clip, Adam: the train.cpp step, synchronously
+void BM_TrainStep(benchmark::State& state) {
+    auto& ds = dataset();
+    const int64_t B = state.range(0);
+    const auto deltas = ds.image_deltas();
+    torch::manual_seed(0);
+    ACTPolicy policy(ds.get_state_mean().size(0), ds.get_action_mean().size(0), 256, 8, CHUNK_SIZE);
+    torch::optim::Adam optimizer(policy->parameters(), 1e-4);
+    auto indices = random_indices(4096, ds.size().value(), 2);
+    size_t next = 0;
+    for (auto _ : state) {
+        std::vector<int64_t> batch_indices;
+        for (int64_t b = 0; b < B; ++b) batch_indices.push_back(indices[next++ % indices.size()]);
+        Batch batch = ds.get_batch(torch::tensor(batch_indices, torch::kInt64));
+        if (ds.load_images()) batch.images = ds.load_window_images(batch.image_rows);
+        auto images = batch.images.defined() ? batch.images
+                                             : torch::full({B, int64_t(deltas.size()), 3, 96, 96}, 128, torch::kUInt8);
+        auto norm_state = (batch.state - ds.get_state_mean()) / (ds.get_state_std() + 1e-5);
+        auto norm_chunk = (batch.action_chunk - ds.get_action_mean()) / (ds.get_action_std() + 1e-5);
+
+        auto loss = chunk_loss(policy->forward(images, norm_state, batch.image_mask), norm_chunk,
+                               batch.action_chunk_mask);
+        optimizer.zero_grad();
+        loss.backward();
+        torch::nn::utils::clip_grad_norm_(policy->parameters(), 1.0);
+        optimizer.step();
+    }
+    state.SetItemsProcessed(state.iterations() * B);
+}
+BENCHMARK(BM_TrainStep)->Arg(1)->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
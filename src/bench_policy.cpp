@@ -0,0 +1,50 @@
+#include "act_policy.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+// Usage: bench_policy [max_batch] [history] [HxW] [state_dim] [action_dim]
+// Forward throughput (samples/sec) of ACTPolicy for B = 1, 2, 4, ... max_batch
+// on random uint8 images, to pick a batch size for this machine.
+int main(int argc, char** argv) {
+    int64_t max_batch = argc > 1 ? std::atoll(argv[1]) : 256;
+    int64_t history = argc > 2 ? std::atoll(argv[2]) : 2;
+    int height = 96, width = 96;
+    if (argc > 3 && std::sscanf(argv[3], "%dx%d", &height, &width) != 2) {
+        std::cerr << "Size must look like 96x96, got " << argv[3] << "\n";
+        return 1;
+    }
+    int state_dim = argc > 4 ? std::atoi(argv[4]) : 2;
+    int action_dim = argc > 5 ? std::atoi(argv[5]) : 2;
+
+    torch::manual_seed(0);
+    ACTPolicy policy(state_dim, action_dim);
+    policy->eval();
+    torch::NoGradGuard no_grad;
+    std::cout << "threads=" << torch::get_num_threads() << " T=" << history << " "
+              << height << "x" << width << "\n";
+
+    std::cout << std::setw(6) << "batch" << std::setw(14) << "ms/batch" << std::setw(14) << "samples/s\n";
+    for (int64_t B = 1; B <= max_batch; B *= 2) {
+        auto images = torch::randint(0, 256, {B, history, 3, height, width}, torch::kUInt8);
+        auto state = torch::randn({B, state_dim});
+        for (int i = 0; i < 2; ++i) policy->forward(images, state);  // warmup
+
+        // at least 5 iterations and 0.5s per batch size
+        int iters = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (iters < 5 || elapsed < 0.5) {
+            policy->forward(images, state);
+            ++iters;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << std::setw(6) << B << std::fixed << std::setprecision(3)
+                  << std::setw(14) << 1e3 * elapsed / iters
+                  << std::setw(13) << std::setprecision(1) << B * iters / elapsed << "\n"
+                  << std::defaultfloat;
+    }
+    return 0;
+}
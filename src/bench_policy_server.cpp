@@ -0,0 +1,142 @@
+#include "policy_server.h"
+#include "profiler.h"
+#include <torch/torch.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage: bench_policy_server [--socket /tmp/lerobot_policy.sock] [--clients 1,2,4,8,16,32]
+//                            [--seconds 5] [--rate 0] [--history 1] [--state-dim 2] [--size 96x96]
+//
+// Load generator for serve_policy. For each client count, that many
+// connections send random observations for --seconds and the sweep reports
+// aggregate throughput and per-request round-trip latency. --rate 0 runs
+// closed loop (next request as soon as the answer arrives); --rate N paces
+// every client at N Hz like a control loop, so latency shows what batching
+// costs a robot at a fixed tick.
+
+namespace {
+
+struct Options {
+    std::string socket = "/tmp/lerobot_policy.sock";
+    std::vector<int> clients{1, 2, 4, 8, 16, 32};
+    double seconds = 5.0;
+    double rate = 0.0;
+    int history = 1;
+    int state_dim = 2;
+    int height = 96, width = 96;
+};
+
+Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--socket") o.socket = value();
+        else if (arg == "--clients") {
+            o.clients.clear();
+            std::stringstream ss(value());
+            for (std::string n; std::getline(ss, n, ',');) o.clients.push_back(std::stoi(n));
+        } else if (arg == "--seconds") o.seconds = std::stod(value());
+        else if (arg == "--rate") o.rate = std::stod(value());
+        else if (arg == "--history") o.history = std::stoi(value());
+        else if (arg == "--state-dim") o.state_dim = std::stoi(value());
+        else if (arg == "--size") {
+            auto v = value();
+            if (std::sscanf(v.c_str(), "%dx%d", &o.height, &o.width) != 2)
+                throw std::invalid_argument("Size must look like 96x96, got " + v);
+        } else {
+            throw std::invalid_argument("Unknown argument " + arg);
+        }
+    }
+    return o;
+}
+
+struct SweepResult {
+    std::vector<double> latency_us;  // ascending
+    double seconds = 0.0;
+    int failed_clients = 0;
+};
+
+SweepResult run_clients(const Options& o, int clients) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::vector<double>> latencies(clients);
+    std::atomic<int> failed{0};
+    std::vector<std::thread> threads;
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.seconds));
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            try {
+                PolicyClient client(o.socket);
+                torch::manual_seed(c);
+                auto images = torch::randint(0, 256, {o.history, 3, o.height, o.width}, torch::kUInt8);
+                auto state = torch::randn({o.state_dim});
+                const auto period = o.rate > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                                     std::chrono::duration<double>(1.0 / o.rate))
+                                               : Clock::duration::zero();
+                // stagger paced clients across the period, as independent robots would be
+                auto next = start + period * c / clients;
+                while (true) {
+                    if (o.rate > 0) std::this_thread::sleep_until(next);
+                    auto sent = Clock::now();
+                    if (sent >= end) break;
+                    client.act(images, state);
+                    latencies[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+                    next += period;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "client " << c << ": " << e.what() << "\n";
+                ++failed;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    SweepResult r;
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& l : latencies) r.latency_us.insert(r.latency_us.end(), l.begin(), l.end());
+    std::sort(r.latency_us.begin(), r.latency_us.end());
+    r.failed_clients = failed;
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    torch::set_num_threads(1);  // clients only copy tensors
+
+    std::cout << "Load on " << o.socket << ": " << o.seconds << "s per point, "
+              << (o.rate > 0 ? std::to_string(o.rate) + " Hz per client" : std::string("closed loop")) << ", T="
+              << o.history << " " << o.height << "x" << o.width << "\n";
+    std::cout << std::setw(8) << "clients" << std::setw(12) << "req/s" << std::setw(11) << "p50 us"
+              << std::setw(11) << "p99 us" << std::setw(11) << "max us" << "\n";
+    for (int clients : o.clients) {
+        SweepResult r = run_clients(o, clients);
+        const auto& l = r.latency_us;
+        std::cout << std::fixed << std::setprecision(1) << std::setw(8) << clients << std::setw(12)
+                  << l.size() / r.seconds << std::setw(11) << percentile(l, 0.50) << std::setw(11)
+                  << percentile(l, 0.99) << std::setw(11) << (l.empty() ? 0.0 : l.back()) << std::defaultfloat;
+        if (r.failed_clients) std::cout << "  (" << r.failed_clients << " clients failed)";
+        std::cout << "\n";
+    }
+    return 0;
+}
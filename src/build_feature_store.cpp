@@ -0,0 +1,76 @@
+#include "feature_store.h"
+#include <torch/torch.h>
+#include <iostream>
+#include <string>
+
+// Usage: build_feature_store <dataset_root> [--backbone checkpoints/act_final.pt] [--hidden 256]
+//                            [--seed 0] [--fp16] [--batch 256] [--out <dataset_root>/features.lrft]
+//
+// Runs the policy's CNN backbone once over every frame and writes the
+// [49, hidden] tokens to a memory-mapped feature store, which
+// `train --features` then feeds to the transformer instead of images. The
+// backbone is taken from a saved policy (--backbone) or, by default, is the
+// initialization train uses (--seed); train rebuilds the store itself when
+// its backbone no longer matches.
+
+namespace {
+
+struct Options {
+    fs::path root;
+    std::string backbone;
+    int hidden = 256;
+    uint64_t seed = 0;
+    bool fp16 = false;
+    int64_t batch = 256;
+    fs::path out;
+};
+
+Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--backbone") o.backbone = value();
+        else if (arg == "--hidden") o.hidden = std::stoi(value());
+        else if (arg == "--seed") o.seed = std::stoull(value());
+        else if (arg == "--fp16") o.fp16 = true;
+        else if (arg == "--batch") o.batch = std::stoll(value());
+        else if (arg == "--out") o.out = value();
+        else if (o.root.empty() && arg.rfind("--", 0) != 0) o.root = arg;
+        else throw std::invalid_argument("Unknown argument " + arg);
+    }
+    if (o.root.empty()) throw std::invalid_argument("Usage: build_feature_store <dataset_root> [options]");
+    if (o.out.empty()) o.out = o.root / FeatureStore::DEFAULT_NAME;
+    return o;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    try {
+        LeRobotDataset dataset(o.root.string(), {{"observation.image", {0.0f}}});
+        // the convolutions are built first, so their initialization depends
+        // only on the seed and hidden size, as in train
+        torch::manual_seed(o.seed);
+        ACTPolicy policy(dataset.get_state_mean().size(0), dataset.get_action_mean().size(0), o.hidden);
+        if (!o.backbone.empty()) policy->load_backbone(o.backbone);
+        std::cout << "Backbone " << (o.backbone.empty() ? "seed " + std::to_string(o.seed) : o.backbone)
+                  << ", fingerprint " << std::hex << policy->backbone_fingerprint() << std::dec << "\n";
+        FeatureStore::build(dataset, policy, o.out, o.fp16, o.batch);
+    } catch (const std::exception& e) {
+        std::cerr << "Feature store build failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "frame_store.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Usage: build_frame_store <dataset_root> [HxW] [out]
+// Decodes every video once into <dataset_root>/frames.lrfs, which
+// LeRobotDataset then maps instead of decoding.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_root> [HxW] [out]\n";
+        return 1;
+    }
+    fs::path root(argv[1]);
+    int height = 0, width = 0;
+    if (argc > 2 && std::sscanf(argv[2], "%dx%d", &height, &width) != 2) {
+        std::cerr << "Size must look like 96x96, got " << argv[2] << "\n";
+        return 1;
+    }
+    fs::path out = argc > 3 ? fs::path(argv[3]) : root / FrameStore::DEFAULT_NAME;
+
+    try {
+        FrameStore::build(root, out, height, width);
+    } catch (const std::exception& e) {
+        std::cerr << "Frame store build failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
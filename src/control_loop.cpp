@@ -0,0 +1,222 @@
+#include "control_loop.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+namespace {
+
+using Clock = DeadlineScheduler::Clock;
+
+double micros(Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); }
+
+Clock::duration period_of(double hz) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+}
+
+void pin_thread(int cpu, const char* name) {
+    Profiler::name_thread(name);
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        std::cerr << "Cannot pin " << name << " thread to CPU " << cpu << ", running unpinned\n";
+}
+
+ControlLoopStats::Thread thread_stats(const DeadlineScheduler& s) {
+    return {s.ticks(), s.misses(), s.skipped(), s.max_wake_late_us()};
+}
+
+}  // namespace
+
+// --- DeadlineScheduler ---
+
+Clock::time_point DeadlineScheduler::wait() {
+    std::this_thread::sleep_until(release_);
+    max_wake_late_us_ = std::max(max_wake_late_us_, micros(Clock::now() - release_));
+    return release_;
+}
+
+void DeadlineScheduler::done() {
+    ++ticks_;
+    const auto now = Clock::now();
+    int64_t overrun = 0;  // whole periods past the deadline
+    if (now > release_ + period_) {
+        ++misses_;
+        overrun = (now - release_) / period_;
+        skipped_ += overrun;
+    }
+    release_ += period_ * (overrun + 1);
+}
+
+// --- Replay sensor / actuator ---
+
+ReplaySensor::ReplaySensor(LeRobotDataset& dataset, size_t episode) {
+    Batch b = dataset.load_episode(episode);
+    if (!b.images.defined()) throw std::runtime_error("Episode " + std::to_string(episode) + " has no images");
+    images_ = b.images;
+    states_ = b.state;
+    actions_ = b.action;
+}
+
+Observation ReplaySensor::make_observation() const {
+    Observation o;
+    o.images = torch::empty_like(images_[0]);
+    o.state = torch::empty_like(states_[0]);
+    return o;
+}
+
+bool ReplaySensor::read(Observation& out, int64_t tick) {
+    if (tick >= images_.size(0)) return false;
+    out.images.copy_(images_[tick]);
+    out.state.copy_(states_[tick]);
+    return true;
+}
+
+ReplayActuator::ReplayActuator(torch::Tensor recorded_actions) : recorded_(recorded_actions.contiguous()) {}
+
+void ReplayActuator::apply(const torch::Tensor& action, int64_t tick) {
+    if (tick >= recorded_.size(0)) return;
+    const int64_t dim = recorded_.size(1);
+    const float* want = recorded_.data_ptr<float>() + tick * dim;
+    auto got = action.accessor<float, 1>();
+    double err = 0.0;
+    for (int64_t d = 0; d < dim; ++d) err += (got[d] - want[d]) * (got[d] - want[d]);
+    sq_err_ += err / dim;
+    ++applied_;
+}
+
+// --- ControlLoop ---
+
+ControlLoop::ControlLoop(Sensor& sensor, BatchedPolicy policy, Actuator& actuator, const ACTConfig& config,
+                         ControlLoopOptions options)
+    : sensor_(sensor), policy_(std::move(policy)), actuator_(actuator), config_(config), options_(options) {
+    if (options_.control_hz <= 0 || options_.policy_hz <= 0) throw std::invalid_argument("Rates must be positive");
+    options_.policy_hz = std::min(options_.policy_hz, options_.control_hz);
+}
+
+ControlLoopStats ControlLoop::run() {
+    LatestValue<Observation> observations([&] { return sensor_.make_observation(); });
+    LatestValue<Command> commands([&] {
+        Command c;
+        c.chunk = torch::empty({config_.chunk_size, config_.action_dim});
+        return c;
+    });
+    std::atomic<bool> running{true};
+    ControlLoopStats stats;
+
+    const auto control_period = period_of(options_.control_hz);
+    const auto policy_period = period_of(options_.policy_hz);
+    // one period of slack so every thread is up before the first release
+    const auto start = Clock::now() + std::max(control_period, policy_period);
+    const auto end = options_.seconds > 0
+                         ? start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.seconds))
+                         : Clock::time_point::max();
+    const size_t expected_ticks = options_.seconds > 0 ? size_t(options_.seconds * options_.control_hz) + 1 : 4096;
+    stats.policy_us.reserve(expected_ticks);
+    stats.end_to_end_us.reserve(expected_ticks);
+
+    std::thread sensor_thread([&] {
+        pin_thread(options_.cpus[0], "sensor");
+        DeadlineScheduler scheduler(control_period, start);
+        while (running) {
+            auto release = scheduler.wait();
+            if (release >= end) break;
+            Observation& o = observations.back();
+            const int64_t tick = (release - start) / control_period;
+            if (!sensor_.read(o, tick)) break;
+            o.seq = tick;
+            o.stamp = Clock::now();
+            observations.publish();
+            scheduler.done();
+        }
+        running = false;  // end of data ends the run
+        stats.sensor = thread_stats(scheduler);
+        stats.observations_unplanned = observations.overwritten();
+    });
+
+    std::thread policy_thread([&] {
+        pin_thread(options_.cpus[1], "policy");
+        torch::InferenceMode inference_mode;
+        DeadlineScheduler scheduler(policy_period, start);
+        while (running) {
+            scheduler.wait();
+            if (observations.fetch()) {
+                PROFILE_SCOPE("control.plan");
+                const Observation& o = observations.front();
+                auto t0 = Clock::now();
+                auto chunk = policy_(o.images.unsqueeze(0), o.state.unsqueeze(0));
+                stats.policy_us.push_back(micros(Clock::now() - t0));
+                Command& c = commands.back();
+                c.chunk.copy_(chunk[0]);
+                c.seq = o.seq;
+                c.stamp = o.stamp;
+                commands.publish();
+            }
+            scheduler.done();
+        }
+        stats.policy = thread_stats(scheduler);
+        stats.commands_unused = commands.overwritten();
+    });
+
+    std::thread actuator_thread([&] {
+        pin_thread(options_.cpus[2], "actuator");
+        DeadlineScheduler scheduler(control_period, start);
+        int64_t applied_seq = -1;
+        while (running) {
+            auto release = scheduler.wait();
+            const int64_t tick = (release - start) / control_period;
+            commands.fetch();
+            const Command& c = commands.front();
+            if (c.seq < 0) {
+                ++stats.idle_ticks;  // nothing planned yet: hold still
+            } else {
+                // chunk row 0 is the capture tick; hold the last row if plans stop coming
+                const int64_t row = std::clamp<int64_t>(tick - c.seq, 0, c.chunk.size(0) - 1);
+                actuator_.apply(c.chunk[row], tick);
+                if (c.seq != applied_seq) {
+                    stats.end_to_end_us.push_back(micros(Clock::now() - c.stamp));
+                    applied_seq = c.seq;
+                }
+            }
+            scheduler.done();
+        }
+        stats.actuator = thread_stats(scheduler);
+    });
+
+    sensor_thread.join();
+    policy_thread.join();
+    actuator_thread.join();
+    return stats;
+}
+
+void ControlLoopStats::report(std::ostream& out) const {
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+    out << "  " << std::left << std::setw(10) << "thread" << std::right << std::setw(9) << "ticks" << std::setw(9)
+        << "misses" << std::setw(9) << "skipped" << std::setw(16) << "max wake-late us" << "\n";
+    auto row = [&](const char* name, const Thread& t) {
+        out << "  " << std::left << std::setw(10) << name << std::right << std::setw(9) << t.ticks << std::setw(9)
+            << t.misses << std::setw(9) << t.skipped << std::setw(16) << t.max_wake_late_us << "\n";
+    };
+    row("sensor", sensor);
+    row("policy", policy);
+    row("actuator", actuator);
+
+    auto latency = [&](const char* name, std::vector<double> us) {
+        if (us.empty()) return;
+        std::sort(us.begin(), us.end());
+        out << "  " << name << " (" << us.size() << ", us): p50 " << percentile(us, 0.5) << "  p99 "
+            << percentile(us, 0.99) << "  max " << us.back() << "\n";
+    };
+    latency("policy forward", policy_us);
+    latency("end-to-end", end_to_end_us);
+    out << "  observations never planned on " << observations_unplanned << ", plans never applied "
+        << commands_unused << ", actuator ticks before first plan " << idle_ticks << "\n";
+    out.flags(flags);
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include "dataset.h"
+#include "policy_export.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Single-producer single-consumer channel that keeps only the newest value:
+// a three-slot ring where the producer fills its back slot and swaps it into
+// the middle, and the consumer swaps the middle out when it is fresh. Neither
+// side ever blocks or waits for the other, and a slot is never shared
+// between them, so values may be large (preallocated tensors are filled in
+// place, not reallocated per tick).
+template <typename T>
+class LatestValue {
+public:
+    // make() is called once per slot; slots must not share storage
+    template <typename Make>
+    explicit LatestValue(Make make) : slots_{make(), make(), make()} {}
+
+    // Producer: fill back(), then publish() it
+    T& back() { return slots_[back_]; }
+    void publish() {
+        uint8_t old = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        if (old & FRESH) ++overwritten_;  // the consumer never saw the previous value
+        back_ = old & INDEX;
+    }
+    uint64_t overwritten() const { return overwritten_; }  // producer side only
+
+    // Consumer: fetch() the newest value if one was published since the
+    // last fetch; front() stays valid and unchanged until the next fetch()
+    bool fetch() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t INDEX = 3, FRESH = 4;
+    std::array<T, 3> slots_;
+    alignas(64) std::atomic<uint8_t> middle_{1};
+    alignas(64) uint8_t back_ = 0;  // producer's
+    uint64_t overwritten_ = 0;
+    alignas(64) uint8_t front_ = 2;  // consumer's
+};
+
+// Fixed-period releases on the steady clock. A tick that finishes after its
+// deadline (the next release) is a miss; the releases it overran are skipped
+// rather than run back to back, so a late tick never causes a burst.
+class DeadlineScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    DeadlineScheduler(Clock::duration period, Clock::time_point start) : period_(period), release_(start) {}
+
+    Clock::time_point wait();  // sleep until the next release, returns it
+    void done();               // end of the tick's work
+
+    uint64_t ticks() const { return ticks_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t skipped() const { return skipped_; }
+    double max_wake_late_us() const { return max_wake_late_us_; }  // release to wake-up
+
+private:
+    Clock::duration period_;
+    Clock::time_point release_;
+    uint64_t ticks_ = 0, misses_ = 0, skipped_ = 0;
+    double max_wake_late_us_ = 0.0;
+};
+
+// One sensor sample: a stack of history frames and the robot state
+struct Observation {
+    int64_t seq = -1;                            // control tick it was captured on
+    DeadlineScheduler::Clock::time_point stamp;  // capture time
+    torch::Tensor images;                        // [T, 3, H, W] uint8
+    torch::Tensor state;                         // [state_dim] float32, raw units
+};
+
+// A planned chunk and the observation it was planned from
+struct Command {
+    int64_t seq = -1;  // tick of the observation; chunk row 0 belongs to it
+    DeadlineScheduler::Clock::time_point stamp;
+    torch::Tensor chunk;  // [chunk_size, action_dim] float32, dataset units
+};
+
+// Hardware boundary. read() and apply() run on the sensor and actuator
+// threads at the control rate and should not block or allocate.
+class Sensor {
+public:
+    virtual ~Sensor() = default;
+    virtual Observation make_observation() const = 0;  // tensors of the right shape
+    // Fill in place for control tick `tick` (ticks skipped after a miss are
+    // never read); false ends the run
+    virtual bool read(Observation& out, int64_t tick) = 0;
+};
+
+class Actuator {
+public:
+    virtual ~Actuator() = default;
+    virtual void apply(const torch::Tensor& action, int64_t tick) = 0;  // [action_dim]
+};
+
+// Plays one recorded episode as a camera + joint encoder, one frame per
+// control tick in wall-clock time. Frames (with history) are decoded up
+// front so decoding never runs in the loop.
+class ReplaySensor : public Sensor {
+public:
+    ReplaySensor(LeRobotDataset& dataset, size_t episode);
+    Observation make_observation() const override;
+    bool read(Observation& out, int64_t tick) override;  // frame `tick` of the episode
+    const torch::Tensor& recorded_actions() const { return actions_; }  // [N, action_dim]
+
+private:
+    torch::Tensor images_, states_, actions_;
+};
+
+// Records what it was told to do and compares it with what the
+// demonstrator did at the same tick.
+class ReplayActuator : public Actuator {
+public:
+    explicit ReplayActuator(torch::Tensor recorded_actions);
+    void apply(const torch::Tensor& action, int64_t tick) override;
+    int64_t applied() const { return applied_; }
+    double mse() const { return applied_ ? sq_err_ / applied_ : 0.0; }
+
+private:
+    torch::Tensor recorded_;
+    double sq_err_ = 0.0;
+    int64_t applied_ = 0;
+};
+
+struct ControlLoopOptions {
+    double control_hz = 10.0;  // sensor and actuator rate
+    double policy_hz = 10.0;   // planning rate, at most control_hz
+    double seconds = 0.0;      // 0 = until the sensor runs out
+    std::array<int, 3> cpus{-1, -1, -1};  // sensor, policy, actuator; -1 leaves a thread unpinned
+};
+
+struct ControlLoopStats {
+    struct Thread {
+        uint64_t ticks = 0, misses = 0, skipped = 0;
+        double max_wake_late_us = 0.0;
+    };
+    Thread sensor, policy, actuator;
+    std::vector<double> policy_us;      // forward time per plan
+    std::vector<double> end_to_end_us;  // capture -> first action of its plan applied
+    uint64_t observations_unplanned = 0;  // overwritten before the policy took them
+    uint64_t commands_unused = 0;         // overwritten before the actuator took them
+    uint64_t idle_ticks = 0;              // actuator ticks before the first plan
+    void report(std::ostream& out) const;
+};
+
+// Three threads connected by LatestValue channels:
+//   sensor   - reads an observation every control tick
+//   policy   - plans a chunk from the newest observation every policy tick
+//   actuator - every control tick applies the row of the newest chunk that
+//              matches the time elapsed since its observation was captured,
+//              so inference latency is compensated rather than added
+// Each runs on its own DeadlineScheduler; the policy thread runs under
+// InferenceMode with whatever torch thread count the caller set.
+class ControlLoop {
+public:
+    ControlLoop(Sensor& sensor, BatchedPolicy policy, Actuator& actuator, const ACTConfig& config,
+                ControlLoopOptions options = {});
+    ControlLoopStats run();
+
+private:
+    Sensor& sensor_;
+    BatchedPolicy policy_;
+    Actuator& actuator_;
+    ACTConfig config_;
+    ControlLoopOptions options_;
+};
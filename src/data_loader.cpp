@@ -0,0 +1,124 @@
+#include "data_loader.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+DataLoader::DataLoader(LeRobotDataset& dataset,
+                       std::shared_ptr<Sampler> sampler,
+                       DataLoaderOptions options)
+    : dataset_(dataset),
+      sampler_(std::move(sampler)),
+      options_(options) {
+    if (options_.batch_size == 0) throw std::invalid_argument("DataLoader: batch_size must be > 0");
+    if (!sampler_ || sampler_->size() < options_.batch_size)
+        throw std::invalid_argument("DataLoader: sampler smaller than one batch");
+    options_.num_workers = std::max<size_t>(options_.num_workers, 1);
+    options_.prefetch = std::max(options_.prefetch, options_.num_workers);
+
+    for (size_t i = 0; i < options_.prefetch; ++i) {
+        slots_.push_back(std::make_unique<Slot>());
+        slots_.back()->batch_id = i;
+    }
+    for (size_t i = 0; i < options_.num_workers; ++i)
+        workers_.emplace_back(&DataLoader::worker_loop, this);
+}
+
+DataLoader::~DataLoader() {
+    stop_ = true;
+    for (auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        slot->cv.notify_all();
+    }
+    for (auto& w : workers_) w.join();
+}
+
+void DataLoader::worker_loop() {
+    Profiler::name_thread("loader worker");
+    while (!stop_) {
+        uint64_t id = next_claim_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = *slots_[id % slots_.size()];
+
+        // --- Wait until the consumer has taken batch id - prefetch ---
+        {
+            std::unique_lock<std::mutex> lock(slot.mutex);
+            slot.cv.wait(lock, [&] { return stop_ || (slot.batch_id == id && !slot.ready); });
+            if (stop_) return;
+        }
+
+        auto start = Clock::now();
+        Batch batch;
+        std::exception_ptr error;
+        try {
+            batch = load_batch(id);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        busy_ns_ += elapsed_ns(start);
+
+        {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            slot.batch = std::move(batch);
+            slot.error = error;
+            slot.ready = true;
+        }
+        slot.cv.notify_all();
+    }
+}
+
+Batch DataLoader::load_batch(uint64_t batch_id) {
+    const size_t B = options_.batch_size;
+    std::vector<int64_t> indices(B);
+    for (size_t i = 0; i < B; ++i) indices[i] = sampler_->index_at(batch_id * B + i);
+
+    // read-ahead for the batch this worker slot serves next (Streaming storage)
+    if (dataset_.storage() == ColumnStorage::Streaming) {
+        std::vector<size_t> upcoming(B);
+        uint64_t ahead = batch_id + slots_.size();
+        for (size_t i = 0; i < B; ++i) upcoming[i] = sampler_->index_at(ahead * B + i);
+        dataset_.prefetch(upcoming);
+    }
+
+    // columns and every episode window in one gather, then each distinct
+    // history frame decoded once
+    PROFILE_SCOPE("loader.batch");
+    Batch batch = dataset_.get_batch(torch::tensor(indices, torch::kInt64));
+    if (dataset_.load_images()) batch.images = dataset_.load_window_images(batch.image_rows);
+    return batch;
+}
+
+Batch DataLoader::next() {
+    Slot& slot = *slots_[next_consume_ % slots_.size()];
+    auto start = Clock::now();
+
+    std::unique_lock<std::mutex> lock(slot.mutex);
+    slot.cv.wait(lock, [&] { return slot.ready; });
+    wait_ns_ += elapsed_ns(start);
+
+    Batch batch = std::move(slot.batch);
+    std::exception_ptr error = slot.error;
+    slot.batch = Batch();
+    slot.error = nullptr;
+    slot.ready = false;
+    slot.batch_id += slots_.size();
+    lock.unlock();
+    slot.cv.notify_all();
+
+    ++next_consume_;
+    ++batches_;
+    if (error) std::rethrow_exception(error);
+    return batch;
+}
+
+DataLoaderStats DataLoader::stats() const {
+    DataLoaderStats s;
+    s.batches = batches_;
+    s.consumer_wait_s = wait_ns_ * 1e-9;
+    s.worker_busy_s = busy_ns_ * 1e-9;
+    return s;
+}
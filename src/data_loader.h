@@ -0,0 +1,69 @@
+#pragma once
+#include "dataset.h"
+#include "sampler.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct DataLoaderOptions {
+    size_t batch_size = 32;
+    size_t num_workers = 4;
+    size_t prefetch = 8;  // ready batches kept ahead of the consumer, >= num_workers
+};
+
+struct DataLoaderStats {
+    uint64_t batches = 0;
+    double consumer_wait_s = 0.0;  // time next() spent blocked on workers
+    double worker_busy_s = 0.0;    // summed over workers: gather + decode
+};
+
+// Runs num_workers threads gathering Batches: LeRobotDataset::get_batch,
+// then load_window_images for the image history. Workers claim batch ids
+// with an atomic counter and draw their indices from the (stateless)
+// sampler; batch b is written into ring slot b % prefetch, so next() hands
+// batches out in sampler order.
+class DataLoader {
+public:
+    DataLoader(LeRobotDataset& dataset,
+               std::shared_ptr<Sampler> sampler,
+               DataLoaderOptions options = {});
+    ~DataLoader();
+
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+
+    Batch next();  // blocks until the next batch is ready; rethrows worker errors
+    DataLoaderStats stats() const;
+    size_t batches_per_epoch() const { return sampler_->size() / options_.batch_size; }
+
+private:
+    struct Slot {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t batch_id = 0;  // id this slot is waiting for / holding
+        bool ready = false;
+        Batch batch;
+        std::exception_ptr error;
+    };
+
+    LeRobotDataset& dataset_;
+    std::shared_ptr<Sampler> sampler_;
+    DataLoaderOptions options_;
+
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<std::thread> workers_;
+    std::atomic<uint64_t> next_claim_{0};
+    std::atomic<bool> stop_{false};
+    uint64_t next_consume_ = 0;
+
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> wait_ns_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+
+    void worker_loop();
+    Batch load_batch(uint64_t batch_id);
+};
@@ -1,12 +1,16 @@
 #include "dataset.h"
+#include "parallel.h"
+#include "profiler.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
 
 using json = nlohmann::json;
 
-static const fs::path NORM_CACHE_PATH = fs::path("/tmp") / "lerobot_norm_cache.json";
-
 static torch::Tensor read_fsl_tensor(
     const std::shared_ptr<arrow::Array>& array,
     int64_t row,
@@ -18,7 +22,7 @@ static torch::Tensor read_fsl_tensor(
 
     if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(array)) {
         auto values = std::static_pointer_cast<arrow::FloatArray>(fsl->values());
-        int offset = static_cast<int>(row) * expected_dim;
+        int64_t offset = fsl->value_offset(row);
         return torch::from_blob(
             const_cast<float*>(values->raw_values() + offset),
             {expected_dim},
@@ -38,209 +42,465 @@ static torch::Tensor read_fsl_tensor(
     return torch::zeros({expected_dim}, torch::kFloat32);
 }
 
-void LeRobotDataset::compute_normalization_from_arrow() {
-    std::cout << "Computing normalization stats from Arrow tables (correct, safe)...\n";
+// --- Column helpers ---
 
-    int state_dim = -1;
-    int action_dim = -1;
+// list_size of a FixedSizeList column, 1 for scalar columns
+static int column_dim(const std::shared_ptr<arrow::ChunkedArray>& col) {
+    if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListType>(col->type()))
+        return fsl->list_size();
+    return 1;
+}
 
-    torch::Tensor state_sum   = torch::zeros({32}, torch::kFloat64);  // big enough
-    torch::Tensor state_sum_sq = torch::zeros({32}, torch::kFloat64);
-    torch::Tensor action_sum   = torch::zeros({32}, torch::kFloat64);
-    torch::Tensor action_sum_sq = torch::zeros({32}, torch::kFloat64);
+// chunk holding `row` of a chunked column and the row's offset inside it
+static std::pair<std::shared_ptr<arrow::Array>, int64_t> chunk_at(
+    const std::shared_ptr<arrow::ChunkedArray>& col, int64_t row) {
+    for (const auto& chunk : col->chunks()) {
+        if (row < chunk->length()) return {chunk, row};
+        row -= chunk->length();
+    }
+    return {nullptr, 0};
+}
 
-    int64_t valid_count = 0;
+// Copy every chunk of a (FixedSizeList of) float/double column into dst,
+// dim values per row. Null rows are left as zeros.
+static void copy_float_column(const std::shared_ptr<arrow::ChunkedArray>& col,
+                              float* dst, int dim) {
+    for (const auto& chunk : col->chunks()) {
+        std::shared_ptr<arrow::Array> values = chunk;
+        int64_t first = 0;
+        if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(chunk)) {
+            values = fsl->values();
+            first = fsl->value_offset(0);  // honours slicing of the list array
+        }
+        const int64_t n = chunk->length() * dim;
+        if (auto fa = std::dynamic_pointer_cast<arrow::FloatArray>(values)) {
+            std::copy_n(fa->raw_values() + first, n, dst);
+        } else if (auto da = std::dynamic_pointer_cast<arrow::DoubleArray>(values)) {
+            std::transform(da->raw_values() + first, da->raw_values() + first + n, dst,
+                           [](double v) { return static_cast<float>(v); });
+        } else {
+            throw std::runtime_error("Unsupported column type: " + col->type()->ToString());
+        }
+        if (chunk->null_count() > 0)
+            for (int64_t r = 0; r < chunk->length(); ++r)
+                if (chunk->IsNull(r)) std::fill_n(dst + r * dim, dim, 0.0f);
+        dst += n;
+    }
+}
 
-    for (const auto& table : tables_) {
-        auto state_col  = table->GetColumnByName(state_column_name_);
-        auto action_col = table->GetColumnByName(action_column_name_);
-        if (!state_col || !action_col) continue;
-
-        // Arrow tables can have multiple chunks → iterate over all chunks
-        for (int c = 0; c < state_col->num_chunks(); ++c) {
-            auto state_chunk  = state_col->chunk(c);
-            auto action_chunk = action_col->chunk(c);
-
-            // Helper lambda for fixed-size-list → flat float vector
-            auto read_fsl = [](const std::shared_ptr<arrow::Array>& arr, int& dim)
-                -> std::vector<float> {
-                if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(arr)) {
-                    if (dim == -1) dim = fsl->list_type()->list_size();
-                    auto values = std::static_pointer_cast<arrow::FloatArray>(fsl->values());
-                    return std::vector<float>(values->raw_values(),
-                                             values->raw_values() + values->length());
-                }
-                return {};
-            };
-
-            // Try FixedSizeListArray first (most common in LeRobot)
-            std::vector<float> all_state_vals;
-            std::vector<float> all_action_vals;
-            int chunk_state_dim = -1, chunk_action_dim = -1;
-
-            if (auto fsl_state = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(state_chunk)) {
-                if (state_dim == -1) state_dim = fsl_state->list_type()->list_size();
-                auto vals = std::static_pointer_cast<arrow::FloatArray>(fsl_state->values());
-                all_state_vals.assign(vals->raw_values(), vals->raw_values() + vals->length());
-            }
-            if (auto fsl_action = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(action_chunk)) {
-                if (action_dim == -1) action_dim = fsl_action->list_type()->list_size();
-                auto vals = std::static_pointer_cast<arrow::FloatArray>(fsl_action->values());
-                all_action_vals.assign(vals->raw_values(), vals->raw_values() + vals->length());
-            }
+template <typename T>
+static void copy_scalar_column(const std::shared_ptr<arrow::ChunkedArray>& col, T* dst) {
+    for (const auto& chunk : col->chunks()) {
+        const int64_t n = chunk->length();
+        if (auto a = std::dynamic_pointer_cast<arrow::DoubleArray>(chunk)) {
+            std::transform(a->raw_values(), a->raw_values() + n, dst, [](double v) { return T(v); });
+        } else if (auto a = std::dynamic_pointer_cast<arrow::FloatArray>(chunk)) {
+            std::transform(a->raw_values(), a->raw_values() + n, dst, [](float v) { return T(v); });
+        } else if (auto a = std::dynamic_pointer_cast<arrow::Int64Array>(chunk)) {
+            std::transform(a->raw_values(), a->raw_values() + n, dst, [](int64_t v) { return T(v); });
+        } else if (auto a = std::dynamic_pointer_cast<arrow::Int32Array>(chunk)) {
+            std::transform(a->raw_values(), a->raw_values() + n, dst, [](int32_t v) { return T(v); });
+        } else {
+            throw std::runtime_error("Unsupported column type: " + col->type()->ToString());
+        }
+        dst += n;
+    }
+}
 
-            // Fallback: plain FloatArray (very rare)
-            if (all_state_vals.empty()) {
-                if (auto fa = std::dynamic_pointer_cast<arrow::FloatArray>(state_chunk)) {
-                    state_dim = 1;
-                    all_state_vals.reserve(fa->length());
-                    for (int64_t i = 0; i < fa->length(); ++i)
-                        if (!fa->IsNull(i)) all_state_vals.push_back(fa->Value(i));
-                }
-            }
-            if (all_action_vals.empty()) {
-                if (auto fa = std::dynamic_pointer_cast<arrow::FloatArray>(action_chunk)) {
-                    action_dim = 1;
-                    all_action_vals.reserve(fa->length());
-                    for (int64_t i = 0; i < fa->length(); ++i)
-                        if (!fa->IsNull(i)) all_action_vals.push_back(fa->Value(i));
-                }
-            }
+// [rows, dim] float32 copy of a (FixedSizeList) column
+static torch::Tensor column_rows(const std::shared_ptr<arrow::ChunkedArray>& col) {
+    int dim = column_dim(col);
+    auto out = torch::zeros({col->length(), dim}, torch::kFloat32);
+    copy_float_column(col, out.data_ptr<float>(), dim);
+    return out;
+}
 
-            if (all_state_vals.empty() || all_action_vals.empty()) continue;
-
-            int64_t rows = all_state_vals.size() / state_dim;
-            for (int64_t r = 0; r < rows; ++r) {
-                bool row_null = false;
-                // check null bitmap for FixedSizeListArray
-                if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(state_chunk))
-                    if (fsl->IsNull(r)) row_null = true;
-                if (auto fsl = std::dynamic_pointer_cast<arrow::FixedSizeListArray>(action_chunk))
-                    if (fsl->IsNull(r)) row_null = true;
-                if (row_null) continue;
-
-                for (int d = 0; d < state_dim; ++d) {
-                    float v = all_state_vals[r * state_dim + d];
-                    state_sum[d]   += v;
-                    state_sum_sq[d] += v * v;
-                }
-                for (int d = 0; d < action_dim; ++d) {
-                    float v = all_action_vals[r * action_dim + d];
-                    action_sum[d]   += v;
-                    action_sum_sq[d] += v * v;
-                }
-                valid_count++;
+static torch::Tensor valid_rows(const std::shared_ptr<arrow::ChunkedArray>& col) {
+    auto valid = torch::ones({col->length()}, torch::kBool);
+    if (col->null_count() == 0) return valid;
+    auto acc = valid.accessor<bool, 1>();
+    int64_t row = 0;
+    for (const auto& chunk : col->chunks())
+        for (int64_t i = 0; i < chunk->length(); ++i, ++row)
+            if (chunk->IsNull(i)) acc[row] = false;
+    return valid;
+}
+
+// Stats over the given data files (indices into data_files_): one partial
+// accumulator per file, filled in parallel, merged in file order.
+std::pair<RunningStats, RunningStats> LeRobotDataset::compute_stats(const std::vector<size_t>& files) {
+    std::vector<RunningStats> state_parts(files.size()), action_parts(files.size());
+    auto accumulate = [&](size_t k, const arrow::Table& table) {
+        auto state_col  = table.GetColumnByName(state_column_name_);
+        auto action_col = table.GetColumnByName(action_column_name_);
+        if (!state_col || !action_col || table.num_rows() == 0) return;
+
+        auto states = column_rows(state_col);
+        auto actions = column_rows(action_col);
+        auto valid = valid_rows(state_col) & valid_rows(action_col);
+        if (!valid.all().item<bool>()) {
+            states = states.index({valid});
+            actions = actions.index({valid});
+        }
+        RunningStats s(states.size(1)), a(actions.size(1));
+        s.update(states);
+        a.update(actions);
+        state_parts[k].merge(s);
+        action_parts[k].merge(a);
+    };
+
+    parallel_for(files.size(), [&](size_t k) {
+        if (stream_) {
+            stream_->scan_file(files[k], {state_column_name_, action_column_name_},
+                               [&](const arrow::Table& t) { accumulate(k, t); });
+        } else {
+            accumulate(k, *tables_[files[k]]);
+        }
+    });
+
+    RunningStats state_stats, action_stats;
+    for (size_t k = 0; k < files.size(); ++k) {
+        state_stats.merge(state_parts[k]);
+        action_stats.merge(action_parts[k]);
+    }
+    return {state_stats, action_stats};
+}
+
+// Stats the previous manifest covers are reused when none of its files were
+// rewritten or removed; files appended since are folded in incrementally.
+void LeRobotDataset::load_normalization_stats(const std::vector<ManifestFile>& current,
+                                              const DatasetManifest* previous) {
+    std::vector<size_t> pending;
+    bool loaded = false;
+
+    // 1. Reuse what the previous manifest covers
+    if (previous) {
+        std::map<std::string, const ManifestFile*> covered;
+        for (const auto& f : previous->files) covered[f.path] = &f;
+
+        bool consistent = true;
+        for (size_t i = 0; i < current.size(); ++i) {
+            auto it = covered.find(current[i].path);
+            if (it == covered.end()) {
+                pending.push_back(i);
+                continue;
             }
+            const ManifestFile& old = *it->second;
+            if (old.size != current[i].size || old.mtime != current[i].mtime) consistent = false;
+            covered.erase(it);
+        }
+        if (consistent && covered.empty()) {  // nothing rewritten or removed
+            state_stats_ = previous->state_stats;
+            action_stats_ = previous->action_stats;
+            loaded = true;
+        } else {
+            pending.clear();
         }
     }
 
-    if (valid_count == 0 || state_dim <= 0 || action_dim <= 0) {
-        std::cerr << "No valid frames for normalization!\n";
+    // 2. Compute what it doesn't cover
+    if (!loaded) {
+        pending.resize(current.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        state_stats_ = RunningStats();
+        action_stats_ = RunningStats();
+        std::cout << "Computing normalization stats over " << pending.size() << " files...\n";
+    } else if (!pending.empty()) {
+        std::cout << "Updating normalization stats with " << pending.size() << " new files...\n";
+    }
+    if (!pending.empty()) {
+        auto [s, a] = compute_stats(pending);
+        state_stats_.merge(s);
+        action_stats_.merge(a);
+    }
+    apply_normalization_stats();
+    if (pending.empty()) {
+        std::cout << "Loaded normalization stats from manifest\n";
         return;
     }
-
-    // Trim tensors to real dimension
-    state_sum   = state_sum.narrow(0, 0, state_dim);
-    state_sum_sq = state_sum_sq.narrow(0, 0, state_dim);
-    action_sum   = action_sum.narrow(0, 0, action_dim);
-    action_sum_sq = action_sum_sq.narrow(0, 0, action_dim);
-
-    auto state_mean = state_sum / valid_count;
-    auto state_std  = (state_sum_sq / valid_count - state_mean.pow(2)).sqrt().clamp_min(1e-6f);
-    auto action_mean = action_sum / valid_count;
-    auto action_std  = (action_sum_sq / valid_count - action_mean.pow(2)).sqrt().clamp_min(1e-6f);
-
-    STATE_MEAN = state_mean.to(torch::kFloat32);
-    STATE_STD  = state_std.to(torch::kFloat32);
-    ACTION_MEAN = action_mean.to(torch::kFloat32);
-    ACTION_STD  = action_std.to(torch::kFloat32);
-
     std::cout << "Computed state_mean=" << STATE_MEAN << "\n";
     std::cout << "action_mean=" << ACTION_MEAN << "\n";
+}
 
-    // Cache to JSON
-    json cache;
-    cache["state_mean"]  = std::vector<float>(STATE_MEAN.data_ptr<float>(),
-                                             STATE_MEAN.data_ptr<float>() + state_dim);
-    cache["state_std"]   = std::vector<float>(STATE_STD.data_ptr<float>(),
-                                             STATE_STD.data_ptr<float>() + state_dim);
-    cache["action_mean"] = std::vector<float>(ACTION_MEAN.data_ptr<float>(),
-                                             ACTION_MEAN.data_ptr<float>() + action_dim);
-    cache["action_std"]  = std::vector<float>(ACTION_STD.data_ptr<float>(),
-                                             ACTION_STD.data_ptr<float>() + action_dim);
-
-    std::ofstream f(NORM_CACHE_PATH);
-    f << std::setw(4) << cache << std::endl;
-
-    std::cout << "Normalization stats computed and cached!\n";
-}
-
-void LeRobotDataset::load_normalization_stats() {
-    // 1. Try to load from cache
-    if (fs::exists(NORM_CACHE_PATH)) {
-        try {
-            std::ifstream f(NORM_CACHE_PATH);
-            json cache;
-            f >> cache;
-
-            if (cache.contains("action_mean") && cache.contains("action_std") &&
-                cache.contains("state_mean") && cache.contains("state_std")) {
-
-                std::vector<float> action_mean_vec = cache["action_mean"].get<std::vector<float>>();
-                std::vector<float> action_std_vec  = cache["action_std"].get<std::vector<float>>();
-                std::vector<float> state_mean_vec  = cache["state_mean"].get<std::vector<float>>();
-                std::vector<float> state_std_vec   = cache["state_std"].get<std::vector<float>>();
-
-                ACTION_MEAN = torch::tensor(action_mean_vec, torch::kFloat32);
-                ACTION_STD  = torch::tensor(action_std_vec,  torch::kFloat32);
-                STATE_MEAN  = torch::tensor(state_mean_vec,  torch::kFloat32);
-                STATE_STD   = torch::tensor(state_std_vec,   torch::kFloat32);
-
-                std::cout << "Loaded normalization stats from cache\n";
-                return;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load cache: " << e.what() << " — recomputing...\n";
-        }
+void LeRobotDataset::apply_normalization_stats() {
+    if (state_stats_.count() == 0 || action_stats_.count() == 0) {
+        std::cerr << "No valid frames for normalization!\n";
+        return;
     }
+    STATE_MEAN  = state_stats_.mean();
+    STATE_STD   = state_stats_.stddev();
+    ACTION_MEAN = action_stats_.mean();
+    ACTION_STD  = action_stats_.stddev();
+}
+
+void LeRobotDataset::save_manifest(std::vector<ManifestFile> files, uint64_t fingerprint, uint64_t schema_hash) {
+    DatasetManifest m;
+    m.fingerprint = fingerprint;
+    m.state_column = state_column_name_;
+    m.action_column = action_column_name_;
+    m.schema_hash = schema_hash;
+    for (size_t i = 0; i < files.size(); ++i) files[i].row_groups = file_row_groups_[i];
+    m.files = std::move(files);
+    m.episode_starts = episode_starts_;
+    m.state_dim = state_stats_.dim();
+    m.action_dim = action_stats_.dim();
+    m.fps = fps_;
+    m.state_stats = state_stats_;
+    m.action_stats = action_stats_;
+    try {
+        m.save(root_ / DatasetManifest::FILE_NAME);
+    } catch (const std::exception& e) {  // e.g. read-only dataset: next start rescans
+        std::cerr << "Could not write manifest: " << e.what() << "\n";
+    }
+}
 
-    // 2. Compute from scratch
-    compute_normalization_from_arrow();
+// Times fn() into `seconds`
+template <typename Fn>
+static void timed(double& seconds, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
-void LeRobotDataset::load_all_parquet(const fs::path& data_dir) {
+// every data/<chunk>/*.parquet, in name order
+static std::vector<fs::path> list_parquet_files(const fs::path& data_dir) {
+    std::vector<fs::path> files;
     for (const auto& chunk_dir : fs::directory_iterator(data_dir)) {
         if (!chunk_dir.is_directory()) continue;
-        for (const auto& file : fs::directory_iterator(chunk_dir)) {
-            if (file.path().extension() != ".parquet") continue;
-
-            // 1. Open file
-            auto maybe_infile = arrow::io::ReadableFile::Open(file.path().string());
-            if (!maybe_infile.ok()) {
-                throw std::runtime_error("Failed to open: " + file.path().string() +
-                                         " - " + maybe_infile.status().ToString());
-            }
-            std::shared_ptr<arrow::io::RandomAccessFile> infile = *maybe_infile;
+        for (const auto& file : fs::directory_iterator(chunk_dir))
+            if (file.path().extension() == ".parquet") files.push_back(file.path());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
 
-            // 2. Open Parquet reader — NEW API (no &reader, no third arg)
-            auto maybe_reader = parquet::arrow::OpenFile(infile, arrow::default_memory_pool());
-            if (!maybe_reader.ok()) {
-                throw std::runtime_error("Parquet open failed: " + maybe_reader.status().ToString());
+// With a manifest matching the files on disk, the episode index, stats and
+// (for Streaming) the row layout come from it instead of the data.
+void LeRobotDataset::load(const fs::path& root) {
+    root_ = root;
+    auto& t = load_timings_;
+    timed(t.total, [&] {
+        std::vector<ManifestFile> files;
+        uint64_t fingerprint = 0, schema_hash = 0;
+        std::optional<DatasetManifest> manifest;
+        timed(t.manifest, [&] {
+            data_files_ = list_parquet_files(root / "data");
+            files = stat_data_files(root, data_files_);
+            std::string schema = data_files_.empty() ? "" : parquet_schema_string(data_files_.front());
+            fingerprint = dataset_fingerprint(files, schema, state_column_name_, action_column_name_);
+            schema_hash = schema_fingerprint(schema);
+            fingerprint_ = fingerprint;
+            manifest = DatasetManifest::load(root / DatasetManifest::FILE_NAME);
+        });
+        const DatasetManifest* fresh =
+            manifest && manifest->fingerprint == fingerprint ? &*manifest : nullptr;
+        if (fresh) std::cout << "Manifest up to date, skipping data scans\n";
+
+        timed(t.parquet, [&] {
+            if (storage_ == ColumnStorage::Streaming) open_parquet_stream(fresh);
+            else load_all_parquet();
+        });
+        timed(t.column_store, [&] {
+            if (storage_ == ColumnStorage::Contiguous) build_column_store();
+        });
+        timed(t.video, [&] {
+            load_video(root / "videos");
+            if (fs::exists(root / FrameStore::DEFAULT_NAME)) {
+                try {
+                    open_frame_store(root / FrameStore::DEFAULT_NAME);
+                } catch (const std::exception& e) {
+                    std::cerr << "Ignoring frame store: " << e.what() << "\n";
+                }
             }
-            std::unique_ptr<parquet::arrow::FileReader> reader = std::move(*maybe_reader);
+            std::vector<std::string> decoded;  // videos the store does not serve
+            for (const auto& path : video_paths_)
+                if (!frame_store_ || !frame_store_->contains(fs::path(path).lexically_relative(root).string()))
+                    decoded.push_back(path);
+            decoder_pool_.warm(decoded);
+        });
+
+        fs::path meta_path = root / "meta" / "info.json";
+        if (fs::exists(meta_path)) {
+            std::ifstream f(meta_path);
+            f >> meta_;
+            if (meta_.contains("fps")) fps_ = meta_["fps"];
+        }
+
+        if (fresh) {
+            episode_starts_ = fresh->episode_starts;
+            state_stats_ = fresh->state_stats;
+            action_stats_ = fresh->action_stats;
+            apply_normalization_stats();
+            return;
+        }
+        timed(t.episode_index, [&] { build_episode_index(root / "meta"); });
+        // stats of other columns (or another schema) would be reused under the
+        // wrong names, possibly with the wrong dim: recompute them all
+        const DatasetManifest* previous = nullptr;
+        if (manifest && manifest->stats_compatible(state_column_name_, action_column_name_, schema_hash))
+            previous = &*manifest;
+        else if (manifest)
+            std::cout << "Manifest built over other columns or schema, recomputing normalization stats\n";
+        timed(t.normalization, [&] { load_normalization_stats(files, previous); });
+        save_manifest(std::move(files), fingerprint, schema_hash);
+    });
+
+    std::vector<int64_t> bounds(episode_starts_.begin(), episode_starts_.end());
+    bounds.push_back(total_frames_);
+    episode_bounds_ = torch::tensor(bounds, torch::kInt64);
+    for (const auto& [key, deltas] : delta_timestamps_) {
+        auto& offsets = window_offsets_[key];
+        for (float delta : deltas) offsets.push_back(std::lround(delta * fps_));
+        std::sort(offsets.begin(), offsets.end());  // same order as image_deltas()
+        // e.g. -0.033 s at 10 fps: both window slots would read the same frame
+        if (std::adjacent_find(offsets.begin(), offsets.end()) != offsets.end())
+            std::cerr << "Warning: delta_timestamps[\"" << key << "\"] has deltas that round to the same frame at "
+                      << fps_ << " fps; use multiples of 1/fps (" << 1.0 / fps_ << " s)\n";
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "Dataset ready in " << t.total << "s (manifest " << t.manifest << "s, parquet "
+              << t.parquet << "s, column store " << t.column_store << "s, video " << t.video
+              << "s, episode index " << t.episode_index << "s, normalization "
+              << t.normalization << "s)\n" << std::defaultfloat;
+}
 
-            // 3. Read table
-            std::shared_ptr<arrow::Table> table;
-            PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+// Files load concurrently; with fewer files than cores each reader also
+// decodes its columns on Arrow's thread pool.
+void LeRobotDataset::load_all_parquet() {
+    const auto& files = data_files_;
+    const bool column_threads = files.size() < default_num_threads();
+    tables_.resize(files.size());
+    file_row_groups_.resize(files.size());
+
+    parallel_for(files.size(), [&](size_t i) {
+        const auto& file_path = files[i];
+        // 1. Open file
+        auto maybe_infile = arrow::io::ReadableFile::Open(file_path.string());
+        if (!maybe_infile.ok()) {
+            throw std::runtime_error("Failed to open: " + file_path.string() +
+                                     " - " + maybe_infile.status().ToString());
+        }
+        std::shared_ptr<arrow::io::RandomAccessFile> infile = *maybe_infile;
 
-            tables_.push_back(table);
-            chunk_frame_counts_.push_back(table->num_rows());
-            total_frames_ += table->num_rows();
+        // 2. Open Parquet reader — NEW API (no &reader, no third arg)
+        auto maybe_reader = parquet::arrow::OpenFile(infile, arrow::default_memory_pool());
+        if (!maybe_reader.ok()) {
+            throw std::runtime_error("Parquet open failed: " + maybe_reader.status().ToString());
         }
+        std::unique_ptr<parquet::arrow::FileReader> reader = std::move(*maybe_reader);
+        reader->set_use_threads(column_threads);
+        auto meta = reader->parquet_reader()->metadata();
+        for (int rg = 0; rg < meta->num_row_groups(); ++rg)
+            file_row_groups_[i].push_back(meta->RowGroup(rg)->num_rows());
+
+        // 3. Read table
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+        tables_[i] = table;
+    });
+
+    for (const auto& table : tables_) {
+        chunk_frame_counts_.push_back(table->num_rows());
+        total_frames_ += table->num_rows();
     }
+    chunk_offsets_.assign(1, 0);
+    for (size_t n : chunk_frame_counts_) chunk_offsets_.push_back(chunk_offsets_.back() + n);
     std::cout << "Loaded " << tables_.size() << " chunks, " << total_frames_ << " frames\n";
 }
 
+void LeRobotDataset::open_parquet_stream(const DatasetManifest* manifest) {
+    ParquetStreamOptions options;
+    options.columns = {state_column_name_, action_column_name_,
+                       "timestamp", "episode_index", "frame_index"};
+    std::vector<std::vector<int64_t>> layout;
+    if (manifest)
+        for (const auto& f : manifest->files) layout.push_back(f.row_groups);
+    stream_ = std::make_unique<ParquetStream>(data_files_, options, layout);
+
+    chunk_offsets_.assign(1, 0);
+    for (size_t f = 0; f < stream_->num_files(); ++f) {
+        chunk_frame_counts_.push_back(stream_->file_rows(f));
+        chunk_offsets_.push_back(chunk_offsets_.back() + stream_->file_rows(f));
+        file_row_groups_.push_back(stream_->row_group_rows(f));
+    }
+    total_frames_ = stream_->num_rows();
+}
+
+void LeRobotDataset::visit_tables(const std::vector<std::string>& columns,
+                                  const std::function<void(const arrow::Table&)>& fn) {
+    if (stream_) {
+        stream_->scan(columns, fn);
+        return;
+    }
+    for (const auto& table : tables_) fn(*table);
+}
+
+void LeRobotDataset::prefetch(const std::vector<size_t>& upcoming) {
+    if (stream_) stream_->hint(upcoming);
+}
+
+void LeRobotDataset::set_stream_memory_budget(size_t bytes) {
+    if (stream_) stream_->set_memory_budget(bytes);
+}
+
+void LeRobotDataset::build_column_store() {
+    if (tables_.empty()) return;
+    auto first = tables_.front();
+    auto state_col = first->GetColumnByName(state_column_name_);
+    auto action_col = first->GetColumnByName(action_column_name_);
+    if (!state_col || !action_col)
+        throw std::runtime_error("Missing " + state_column_name_ + " or " + action_column_name_ + " column");
+
+    const int64_t N = total_frames_;
+    const int state_dim = column_dim(state_col);
+    const int action_dim = column_dim(action_col);
+    states_ = torch::zeros({N, state_dim}, torch::kFloat32);
+    actions_ = torch::zeros({N, action_dim}, torch::kFloat32);
+    timestamps_ = torch::zeros({N}, torch::kFloat64);
+    episode_indices_ = torch::zeros({N}, torch::kInt64);
+
+    // tables own disjoint row ranges, so they fill in parallel
+    parallel_for(tables_.size(), [&](size_t c) {
+        const auto& table = tables_[c];
+        const int64_t row = chunk_offsets_[c];
+        copy_float_column(table->GetColumnByName(state_column_name_),
+                          states_.data_ptr<float>() + row * state_dim, state_dim);
+        copy_float_column(table->GetColumnByName(action_column_name_),
+                          actions_.data_ptr<float>() + row * action_dim, action_dim);
+        if (auto ts = table->GetColumnByName("timestamp"))
+            copy_scalar_column(ts, timestamps_.data_ptr<double>() + row);
+        if (auto ep = table->GetColumnByName("episode_index"))
+            copy_scalar_column(ep, episode_indices_.data_ptr<int64_t>() + row);
+    });
+    std::cout << "Column store: " << N << " rows, state_dim=" << state_dim
+              << " action_dim=" << action_dim << "\n";
+}
+
+std::pair<size_t, size_t> LeRobotDataset::episode_range(size_t episode) const {
+    if (episode >= episode_starts_.size())
+        throw std::out_of_range("Episode " + std::to_string(episode) + " out of range");
+    size_t end = episode + 1 < episode_starts_.size() ? episode_starts_[episode + 1] : total_frames_;
+    return {episode_starts_[episode], end};
+}
+
+Batch LeRobotDataset::load_episode(size_t episode) {
+    auto [first, end] = episode_range(episode);
+    if (first >= end) throw std::runtime_error("Episode " + std::to_string(episode) + " is empty");
+    Batch b = get_batch(torch::arange(int64_t(first), int64_t(end), torch::kInt64));
+    b.images = load_window_images(b.image_rows);
+    return b;
+}
+
+// binary search over the chunk prefix sums
+std::pair<size_t, size_t> LeRobotDataset::locate(size_t global_index) const {
+    if (global_index >= total_frames_)
+        throw std::out_of_range("Frame index " + std::to_string(global_index) + " out of range");
+    auto it = std::upper_bound(chunk_offsets_.begin(), chunk_offsets_.end(), global_index);
+    size_t chunk_idx = std::distance(chunk_offsets_.begin(), it) - 1;
+    return {chunk_idx, global_index - chunk_offsets_[chunk_idx]};
+}
+
 // load video files
 void LeRobotDataset::load_video(const fs::path& video_dir) {
   for (const auto& cam_dir : fs::directory_iterator(video_dir)) {
@@ -250,91 +510,183 @@ void LeRobotDataset::load_video(const fs::path& video_dir) {
       for (const auto& file : fs::directory_iterator(chunk_dir)) {
         if (file.path().extension() != ".mp4") continue;
         std::string path = file.path().string();
-        video_captures_[path].open(path);
-        if (!video_captures_[path].isOpened())
-          std::cerr << "Failed to open video: " << path << "\n";
+        video_paths_.push_back(path);  // decoders open lazily in decoder_pool_
       }
     }
   }
+  std::sort(video_paths_.begin(), video_paths_.end());
 }
 
 // build episode start indices
-void LeRobotDataset::build_episode_index() {
-    size_t global_idx = 0;
-    for (const auto& table : tables_) {
-        auto ep_col = table->GetColumnByName("episode_index");
-        if (!ep_col) continue;
-        auto arr = std::static_pointer_cast<arrow::Int64Array>(ep_col->chunk(0));
+void LeRobotDataset::build_episode_index(const fs::path& meta_dir) {
+    episode_starts_.assign(1, 0);  // first episode
+    if (episode_indices_.defined() && episode_indices_.numel() > 0) {
+        auto ep = episode_indices_;
+        auto starts = torch::nonzero(ep.slice(0, 1) != ep.slice(0, 0, -1)).flatten() + 1;
+        auto acc = starts.accessor<int64_t, 1>();
+        for (int64_t i = 0; i < acc.size(0); ++i) episode_starts_.push_back(acc[i]);
+        return;
+    }
+
+    // Streaming: episode lengths from meta/episodes.jsonl, no data read
+    fs::path episodes_path = meta_dir / "episodes.jsonl";
+    if (stream_ && fs::exists(episodes_path)) {
+        std::map<int64_t, size_t> lengths;
+        std::ifstream f(episodes_path);
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty()) continue;
+            auto ep = json::parse(line);
+            lengths[ep["episode_index"].get<int64_t>()] = ep["length"].get<size_t>();
+        }
+        size_t start = 0;
+        for (const auto& [ep, length] : lengths) {
+            start += length;
+            if (start < total_frames_) episode_starts_.push_back(start);
+        }
+        if (start == total_frames_) return;
+        std::cerr << "episodes.jsonl covers " << start << " of " << total_frames_
+                  << " frames, scanning episode_index instead\n";
+        episode_starts_.assign(1, 0);
+    }
+
+    // Tables: boundaries inside each table in parallel, then merged in order
+    if (!stream_) {
+        struct Part {
+            std::vector<size_t> starts;  // local rows
+            int64_t first = -1, last = -1;
+        };
+        std::vector<Part> parts(tables_.size());
+        parallel_for(tables_.size(), [&](size_t c) {
+            auto ep_col = tables_[c]->GetColumnByName("episode_index");
+            if (!ep_col || tables_[c]->num_rows() == 0) return;
+            std::vector<int64_t> eps(tables_[c]->num_rows());
+            copy_scalar_column(ep_col, eps.data());
+            for (size_t i = 1; i < eps.size(); ++i)
+                if (eps[i] != eps[i - 1]) parts[c].starts.push_back(i);
+            parts[c].first = eps.front();
+            parts[c].last = eps.back();
+        });
         int64_t prev = -1;
-        for (int64_t i = 0; i < arr->length(); ++i) {
-            int64_t ep = arr->Value(i);
-            if (ep != prev && i > 0) {
-                episode_starts_.push_back(global_idx + i);
-            }
-            prev = ep;
+        for (size_t c = 0; c < parts.size(); ++c) {
+            if (parts[c].first == -1) continue;
+            if (chunk_offsets_[c] > 0 && parts[c].first != prev) episode_starts_.push_back(chunk_offsets_[c]);
+            for (size_t local : parts[c].starts) episode_starts_.push_back(chunk_offsets_[c] + local);
+            prev = parts[c].last;
         }
-        global_idx += table->num_rows();
+        return;
     }
-    episode_starts_.push_back(0);  // first episode
-    std::sort(episode_starts_.begin(), episode_starts_.end());
+
+    // Streaming: every row group of the episode_index column, in order
+    size_t global_idx = 0;
+    int64_t prev = -1;
+    visit_tables({"episode_index"}, [&](const arrow::Table& table) {
+        auto ep_col = table.GetColumnByName("episode_index");
+        if (ep_col) {
+            std::vector<int64_t> eps(table.num_rows());
+            copy_scalar_column(ep_col, eps.data());
+            for (size_t i = 0; i < eps.size(); ++i) {
+                if (eps[i] != prev && global_idx + i > 0) episode_starts_.push_back(global_idx + i);
+                prev = eps[i];
+            }
+        }
+        global_idx += table.num_rows();
+    });
 }
 
 // decode image at timestamp
 cv::Mat LeRobotDataset::decode_frame(const std::string& video_path, double timestamp_sec) {
-    auto& cap = video_captures_[video_path];
-    if (!cap.isOpened()) return cv::Mat();
-
-    int frame_idx = static_cast<int>(timestamp_sec * fps_);
-    cap.set(cv::CAP_PROP_POS_FRAMES, frame_idx);
+    PROFILE_SCOPE("decode_frame");
+    // nearest frame: truncation maps e.g. 0.0333 * 30 = 0.999 onto frame 0
+    int frame_idx = static_cast<int>(std::lround(timestamp_sec * fps_));
+    if (frame_store_) {
+        auto key = fs::path(video_path).lexically_relative(root_).string();
+        if (frame_store_->contains(key)) return frame_store_->frame(key, frame_idx);
+    }
     cv::Mat frame;
-    cap >> frame;
+    if (frame_cache_.get(video_path, frame_idx, frame)) return frame;
+
+    {
+        auto decoder = decoder_pool_.acquire(video_path, frame_idx);
+        if (!decoder) return cv::Mat();
+        PROFILE_SCOPE("video.read");  // cache misses only
+        frame = decoder->read(frame_idx);
+    }
+    frame_cache_.put(video_path, frame_idx, frame);
     return frame;
 }
 
+void LeRobotDataset::open_frame_store(const fs::path& path) {
+    auto store = std::make_unique<FrameStore>(path);
+    auto stale = store->drop_stale(root_);
+    if (!stale.empty())
+        std::cout << "Frame store " << path << ": " << stale.size() << " video(s) changed since it was built"
+                  << " (e.g. " << stale.front() << "), decoding them instead\n";
+    frame_store_ = std::move(store);
+    std::cout << "Using frame store " << path << " (" << frame_store_->width() << "x"
+              << frame_store_->height() << ")\n";
+}
+
+std::string LeRobotDataset::video_path_for_chunk(size_t chunk_idx) const {
+    std::string video_path;
+    if (stream_) {
+        video_path = stream_->file_metadata(chunk_idx, "video_path");
+    } else if (const auto& table = tables_[chunk_idx]; table->schema()->metadata()) {
+        auto meta = table->schema()->metadata();
+        if (meta->FindKey("video_path") != -1)
+            video_path = meta->Get("video_path").ValueOr("");
+    }
+    if (video_path.empty() && !video_paths_.empty())
+        video_path = video_paths_.front();
+    return video_path;
+}
+
 // get() - full frame with delta images
 Frame LeRobotDataset::get(size_t global_index) {
+    PROFILE_SCOPE("dataset.get");
+    return read_frame(global_index, load_images_);
+}
+
+Frame LeRobotDataset::read_frame(size_t global_index, bool with_images) {
     // --- Find chunk & local index ---
-    size_t chunk_idx = 0, local_idx = global_index;
-    for (size_t i = 0; i < chunk_frame_counts_.size(); ++i) {
-        if (local_idx < chunk_frame_counts_[i]) {
-            chunk_idx = i;
-            break;
-        }
-        local_idx -= chunk_frame_counts_[i];
-    }
-    auto table = tables_[chunk_idx];
+    auto [chunk_idx, local_idx] = locate(global_index);
     Frame f;
-
-    // DYNAMIC DIMENSIONS
-    int state_dim = STATE_MEAN.size(0);
-    int action_dim = ACTION_MEAN.size(0);
-
-    auto state_col = table->GetColumnByName(state_column_name_);
-    auto action_col = table->GetColumnByName(action_column_name_);
-
-    if (!state_col || !action_col) {
-        std::cerr << "Missing observation.state or action column!\n";
-        return f;
+    ScopedTimer columns_timer("dataset.columns");
+
+    if (storage_ == ColumnStorage::Contiguous) {
+        // zero-copy row views into the column store
+        f.state = states_[global_index];
+        f.action = actions_[global_index];
+        f.timestamp = timestamps_.data_ptr<double>()[global_index];
+    } else {
+        // a decoded row group (Streaming) or a whole file's table (Tables);
+        // either may hold its columns in several Arrow chunks
+        int64_t row = local_idx;
+        auto table = stream_ ? stream_->row_group(global_index, row) : tables_[chunk_idx];
+        auto state_col = table->GetColumnByName(state_column_name_);
+        auto action_col = table->GetColumnByName(action_column_name_);
+        if (!state_col || !action_col) {
+            std::cerr << "Missing observation.state or action column!\n";
+            return f;
+        }
+        auto [state_chunk, state_row] = chunk_at(state_col, row);
+        auto [action_chunk, action_row] = chunk_at(action_col, row);
+        f.state  = read_fsl_tensor(state_chunk, state_row, column_dim(state_col));
+        f.action = read_fsl_tensor(action_chunk, action_row, column_dim(action_col));
+        if (auto ts_col = table->GetColumnByName("timestamp")) {
+            auto [ts_chunk, ts_row] = chunk_at(ts_col, row);
+            if (auto ts = std::dynamic_pointer_cast<arrow::DoubleArray>(ts_chunk))
+                f.timestamp = ts->Value(ts_row);
+            else if (auto ts = std::dynamic_pointer_cast<arrow::FloatArray>(ts_chunk))
+                f.timestamp = ts->Value(ts_row);
+        }
     }
-    f.state  = read_fsl_tensor(state_col->chunk(0),  local_idx, state_dim);
-    f.action = read_fsl_tensor(action_col->chunk(0), local_idx, action_dim);
 
-    // --- Timestamp ---
-    auto ts_arr = std::static_pointer_cast<arrow::DoubleArray>(
-        table->GetColumnByName("timestamp")->chunk(0));
-    if (ts_arr && local_idx < ts_arr->length())
-        f.timestamp = ts_arr->Value(local_idx);
+    columns_timer.stop();
 
     // --- Images ---
-    if (load_images_) {  // ← ONLY LOAD IMAGES WHEN ENABLED
-    std::string video_path;
-    if (table->schema()->metadata()) {
-        auto meta = table->schema()->metadata();
-        if (meta->FindKey("video_path") != -1)
-            video_path = meta->Get("video_path").ValueOr("");
-    }
-    if (video_path.empty() && !video_captures_.empty())
-        video_path = video_captures_.begin()->first;
+    if (with_images) {  // ← ONLY LOAD IMAGES WHEN ENABLED
+    std::string video_path = video_path_for_chunk(chunk_idx);
 
     for (const auto& [modality, deltas] : delta_timestamps_) {
         if (modality != "observation.image") continue;
@@ -350,7 +702,135 @@ Frame LeRobotDataset::get(size_t global_index) {
     return f;
 }
 
+// gather rows for a batch of indices; images are left to get()
+Batch LeRobotDataset::get_batch(const torch::Tensor& indices) {
+    Batch b;
+    b.indices = indices.to(torch::kInt64);
+    if (storage_ == ColumnStorage::Contiguous) {
+        b.state = states_.index_select(0, b.indices);
+        b.action = actions_.index_select(0, b.indices);
+        b.timestamp = timestamps_.index_select(0, b.indices);
+        gather_windows(b);
+        return b;
+    }
+
+    std::vector<torch::Tensor> states, actions;
+    std::vector<double> timestamps;
+    auto idx = b.indices.accessor<int64_t, 1>();
+    for (int64_t i = 0; i < idx.size(0); ++i) {
+        Frame f = read_frame(idx[i], false);
+        states.push_back(f.state);
+        actions.push_back(f.action);
+        timestamps.push_back(f.timestamp);
+    }
+    b.state = torch::stack(states);
+    b.action = torch::stack(actions);
+    b.timestamp = torch::tensor(timestamps, torch::kFloat64);
+    gather_windows(b);
+    return b;
+}
+
+size_t LeRobotDataset::window_size(const std::string& key) const {
+    auto it = window_offsets_.find(key);
+    return it == window_offsets_.end() ? 0 : it->second.size();
+}
+
+EpisodeWindow LeRobotDataset::episode_window(const torch::Tensor& indices, const std::string& key) const {
+    auto it = window_offsets_.find(key);
+    if (it == window_offsets_.end() || it->second.empty()) return {};
+    auto idx = indices.to(torch::kInt64);
+
+    // episode [start, end) of every index, then rows clamped into it
+    auto ep = torch::searchsorted(episode_bounds_, idx, /*out_int32=*/false, /*right=*/true) - 1;
+    auto start = episode_bounds_.index_select(0, ep).unsqueeze(1);
+    auto end = episode_bounds_.index_select(0, ep + 1).unsqueeze(1);
+    auto rows = idx.unsqueeze(1) + torch::tensor(it->second, torch::kInt64);  // [B, k]
+    EpisodeWindow w;
+    w.mask = (rows >= start) & (rows < end);
+    w.rows = torch::max(torch::min(rows, end - 1), start);
+    return w;
+}
+
+torch::Tensor LeRobotDataset::gather_rows(const torch::Tensor& rows, bool state) {
+    if (storage_ == ColumnStorage::Contiguous) return (state ? states_ : actions_).index_select(0, rows);
+    std::vector<torch::Tensor> out;
+    auto acc = rows.accessor<int64_t, 1>();
+    for (int64_t i = 0; i < acc.size(0); ++i) {
+        Frame f = read_frame(acc[i], false);
+        out.push_back(state ? f.state : f.action);
+    }
+    return torch::stack(out);
+}
+
+std::pair<torch::Tensor, torch::Tensor> LeRobotDataset::gather_action_chunk(const torch::Tensor& indices) {
+    auto w = episode_window(indices, "action");
+    if (!w.rows.defined()) return {};
+    auto chunk = gather_rows(w.rows.flatten(), /*state=*/false);
+    return {chunk.view({w.rows.size(0), w.rows.size(1), -1}), w.mask};
+}
+
+void LeRobotDataset::gather_windows(Batch& b) {
+    std::tie(b.action_chunk, b.action_chunk_mask) = gather_action_chunk(b.indices);
+    if (auto w = episode_window(b.indices, state_column_name_); w.rows.defined()) {
+        b.state_history = gather_rows(w.rows.flatten(), /*state=*/true).view({w.rows.size(0), w.rows.size(1), -1});
+        b.state_history_mask = w.mask;
+    }
+    if (auto w = episode_window(b.indices, "observation.image"); w.rows.defined()) {
+        b.image_rows = w.rows;
+        b.image_mask = w.mask;
+    } else {  // just the frame itself, as image_deltas() = {0}
+        b.image_rows = b.indices.unsqueeze(1);
+        b.image_mask = torch::ones_like(b.image_rows, torch::kBool);
+    }
+}
+
+torch::Tensor LeRobotDataset::load_window_images(const torch::Tensor& rows) {
+    PROFILE_SCOPE("dataset.window_images");
+    // neighbouring indices share most of their history: decode each row once,
+    // ascending, so leased decoders keep reading forward
+    torch::Tensor unique, inverse;
+    std::tie(unique, inverse, std::ignore) =
+        torch::_unique2(rows.flatten(), /*sorted=*/true, /*return_inverse=*/true);
+    auto u = unique.accessor<int64_t, 1>();
+    std::vector<cv::Mat> mats(u.size(0));
+    for (int64_t i = 0; i < u.size(0); ++i) {
+        const size_t row = u[i];
+        double ts = storage_ == ColumnStorage::Contiguous ? timestamps_.data_ptr<double>()[row]
+                                                          : read_frame(row, false).timestamp;
+        mats[i] = decode_frame(video_path_for_chunk(locate(row).first), ts);
+    }
+    auto first = std::find_if(mats.begin(), mats.end(), [](const cv::Mat& m) { return !m.empty(); });
+    if (first == mats.end()) return {};
+
+    const cv::Size size = first->size();
+    const int channels = first->channels();
+    auto frames = torch::zeros({int64_t(mats.size()), channels, size.height, size.width}, torch::kUInt8);
+    for (size_t i = 0; i < mats.size(); ++i) {
+        if (mats[i].empty()) continue;  // stays zero
+        cv::Mat img = mats[i];
+        if (img.size() != size) cv::resize(img, img, size);
+        if (!img.isContinuous()) img = img.clone();
+        frames[i].copy_(torch::from_blob(img.data, {img.rows, img.cols, channels}, torch::kUInt8).permute({2, 0, 1}));
+    }
+    return frames.index_select(0, inverse).view({rows.size(0), rows.size(1), channels, size.height, size.width});
+}
+
+// sorted image deltas, i.e. the T axis of a collated batch
+std::vector<float> LeRobotDataset::image_deltas() const {
+    auto it = delta_timestamps_.find("observation.image");
+    if (it == delta_timestamps_.end()) return {0.0f};
+    std::vector<float> deltas = it->second;
+    std::sort(deltas.begin(), deltas.end());
+    return deltas;
+}
+
 void LeRobotDataset::print_all_column_names() const {
+    if (stream_) {
+        std::cout << "Table columns: ";
+        for (const auto& name : stream_->schema()->field_names()) std::cout << name << "  ";
+        std::cout << "\n";
+        return;
+    }
     for (const auto& table : tables_) {
         std::cout << "Table columns: ";
         for (const auto& name : table->ColumnNames()) {
@@ -6,12 +6,19 @@
 #include <parquet/arrow/reader.h>
 #include <nlohmann/json.hpp>
 #include <opencv2/opencv.hpp>
+#include "video_decoder.h"
+#include "frame_store.h"
+#include "parquet_stream.h"
+#include "normalization.h"
+#include "manifest.h"
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 
 namespace fs = std::filesystem;
@@ -23,61 +30,178 @@ struct Frame {
     double timestamp = 0.0;
 };
 
+// Collated frames. Images are stacked oldest delta first; frames whose delta
+// fell before the start of the video are padded and flagged in image_mask.
+struct Batch {
+    torch::Tensor indices;     // [B] int64
+    torch::Tensor state;       // [B, state_dim] float32
+    torch::Tensor action;      // [B, action_dim] float32
+    torch::Tensor timestamp;   // [B] float64
+    torch::Tensor images;      // [B, T, C, H, W] uint8, undefined without images
+    torch::Tensor image_mask;  // [B, T] bool
+    // Future actions at delta_timestamps["action"], clamped to the frame's
+    // episode; steps past its end repeat the last action and are false in
+    // action_chunk_mask. Undefined without "action" deltas.
+    torch::Tensor action_chunk;       // [B, k, action_dim] float32
+    torch::Tensor action_chunk_mask;  // [B, k] bool
+    // Past states at delta_timestamps["observation.state"], clamped and
+    // masked the same way. Undefined without "observation.state" deltas.
+    torch::Tensor state_history;       // [B, ks, state_dim] float32
+    torch::Tensor state_history_mask;  // [B, ks] bool
+    torch::Tensor image_rows;          // [B, T] int64, frame each history image comes from
+};
+
+// Frame rows of a per-index window: for every index and every (sorted)
+// delta of one delta_timestamps key, the row delta * fps frames away,
+// clamped into the index's episode. mask is false where clamping replaced
+// the row, i.e. the step is padding.
+struct EpisodeWindow {
+    torch::Tensor rows;  // [B, k] int64
+    torch::Tensor mask;  // [B, k] bool
+};
+
+// Where state/action rows live:
+//  Tables     - whole Parquet files as Arrow tables, rows read per get()
+//  Contiguous - Tables flattened into contiguous tensors at construction
+//  Streaming  - only the training columns, row groups decoded on demand
+enum class ColumnStorage { Tables, Contiguous, Streaming };
+
+// Wall time of each constructor phase, in seconds
+struct LoadTimings {
+    double manifest = 0.0;  // listing, stat and fingerprint of the data files
+    double parquet = 0.0;
+    double column_store = 0.0;
+    double video = 0.0;
+    double episode_index = 0.0;
+    double normalization = 0.0;
+    double total = 0.0;
+};
+
 class LeRobotDataset : public torch::data::datasets::Dataset<LeRobotDataset, Frame> {
 public:
     LeRobotDataset(const std::string& root_path,
                    const std::map<std::string, std::vector<float>>& delta_timestamps = {},
 		   const std::string& state_col = "observation.state",
-		   const std::string& action_col = "action")
-        : delta_timestamps_(delta_timestamps),
+		   const std::string& action_col = "action",
+		   ColumnStorage storage = ColumnStorage::Contiguous)
+        : storage_(storage),
+          delta_timestamps_(delta_timestamps),
 	  state_column_name_(state_col),
 	  action_column_name_(action_col),
           ACTION_MEAN(torch::zeros({2}, torch::kFloat32)),
           ACTION_STD(torch::ones({2}, torch::kFloat32)),
           STATE_MEAN(torch::zeros({2}, torch::kFloat32)),
           STATE_STD(torch::ones({2}, torch::kFloat32)) {
-        fs::path root(root_path);
-        load_all_parquet(root / "data");
-        load_video(root / "videos");
-        build_episode_index();
-
-        fs::path meta_path = fs::path(root_path) / "meta" / "info.json";
-        if (fs::exists(meta_path)) {
-            std::ifstream f(meta_path);
-            f >> meta_;
-            if (meta_.contains("fps")) fps_ = meta_["fps"];
-        }
-        load_normalization_stats();
+        load(root_path);
     }
 
+    // In Contiguous storage state/action are views into the column store:
+    // clone them before modifying in place.
     Frame get(size_t index) override;
+    Batch get_batch(const torch::Tensor& indices);  // columns only, no images
+    // Action targets for each index (see Batch::action_chunk)
+    std::pair<torch::Tensor, torch::Tensor> gather_action_chunk(const torch::Tensor& indices);
+    // Window for delta_timestamps[key]; undefined tensors without such deltas
+    EpisodeWindow episode_window(const torch::Tensor& indices, const std::string& key) const;
+    // Fills state_history, action_chunk and image_rows/image_mask of a batch
+    // whose indices are set, one index_select per column (Contiguous storage)
+    void gather_windows(Batch& batch);
+    // Images of image_rows [B, T] -> [B, T, C, H, W] uint8, decoding each
+    // distinct row once and in row order; undefined if nothing decodes
+    torch::Tensor load_window_images(const torch::Tensor& rows);
+    size_t num_episodes() const { return episode_starts_.size(); }
+    double fps() const { return fps_; }
+    // Paths, sizes and mtimes of the data files, their schema and the
+    // state/action columns (see dataset_fingerprint), with or without a manifest
+    uint64_t fingerprint() const { return fingerprint_; }
+    std::pair<size_t, size_t> episode_range(size_t episode) const;  // [first, end) frames
+    // Every frame of one episode with its image history, windows clamped to
+    // the episode as in training, e.g. to replay it as a live stream;
+    // images undefined if nothing decodes
+    Batch load_episode(size_t episode);
+    size_t action_horizon() const { return window_size("action"); }  // k, 0 without "action" deltas
+    size_t window_size(const std::string& key) const;
     void print_all_column_names() const;
     c10::optional<size_t> size() const override { return total_frames_; }
     void set_load_images(bool enable) { load_images_ = enable; } 
+    bool load_images() const { return load_images_; }
+    std::vector<float> image_deltas() const;
     torch::Tensor get_action_mean() const { return ACTION_MEAN; }
     torch::Tensor get_action_std()  const { return ACTION_STD; }
     torch::Tensor get_state_mean()  const { return STATE_MEAN; }
     torch::Tensor get_state_std()   const { return STATE_STD; }
+    // full statistics (min/max/quantiles too), see make_normalizer
+    const RunningStats& state_stats() const { return state_stats_; }
+    const RunningStats& action_stats() const { return action_stats_; }
+    ColumnStorage storage() const { return storage_; }
+    const LoadTimings& load_timings() const { return load_timings_; }
+    torch::Tensor states() const { return states_; }    // [N, state_dim], Contiguous storage only
+    torch::Tensor actions() const { return actions_; }  // [N, action_dim], Contiguous storage only
+    // Read-ahead hint for Streaming storage (no-op otherwise): rows the
+    // sampler will hand out next, in order.
+    void prefetch(const std::vector<size_t>& upcoming);
+    void set_stream_memory_budget(size_t bytes);
+    void set_frame_cache_bytes(size_t bytes) { frame_cache_.set_capacity(bytes); }
+    FrameCacheStats frame_cache_stats() const { return frame_cache_.stats(); }
+    DecoderPoolStats decoder_pool_stats() const { return decoder_pool_.stats(); }
+    // Serve images from a pre-decoded store (see FrameStore::build) instead
+    // of decoding; videos missing from the store, or changed on disk since it
+    // was built, still go through decoders.
+    void open_frame_store(const fs::path& path);
 
 private:
+    ColumnStorage storage_ = ColumnStorage::Contiguous;
     bool load_images_ = true;
     std::string state_column_name_;
     std::string action_column_name_;
+    std::vector<fs::path> data_files_;  // one per table / stream file, name order
     std::vector<std::shared_ptr<arrow::Table>> tables_;
+    std::vector<std::vector<int64_t>> file_row_groups_;  // rows per row group, for the manifest
     std::vector<size_t> chunk_frame_counts_;
+    std::vector<size_t> chunk_offsets_;  // prefix sums of chunk_frame_counts_, size chunks + 1
     std::vector<size_t> episode_starts_;
+    torch::Tensor episode_bounds_;        // [episodes + 1] int64: episode_starts_, then total_frames_
+    std::map<std::string, std::vector<int64_t>> window_offsets_;  // sorted delta_timestamps in frames
     size_t total_frames_ = 0;
-    std::unordered_map<std::string, cv::VideoCapture> video_captures_;
+    fs::path root_;
+    std::vector<std::string> video_paths_;
+    std::unique_ptr<FrameStore> frame_store_;
+    DecoderPool decoder_pool_;  // one leased decoder per concurrent get(), so get() is thread-safe
+    FrameCache frame_cache_;
     double fps_ = 30.0;
+    uint64_t fingerprint_ = 0;
     std::map<std::string, std::vector<float>> delta_timestamps_;
     nlohmann::json meta_;
 
+    std::unique_ptr<ParquetStream> stream_;  // Streaming storage
+    LoadTimings load_timings_;
+
+    // --- Column store (Contiguous storage): all tables flattened, row = global index ---
+    torch::Tensor states_;           // [N, state_dim] float32
+    torch::Tensor actions_;          // [N, action_dim] float32
+    torch::Tensor timestamps_;       // [N] float64
+    torch::Tensor episode_indices_;  // [N] int64
+
     torch::Tensor ACTION_MEAN, ACTION_STD, STATE_MEAN, STATE_STD;
+    RunningStats state_stats_, action_stats_;
 
-    void compute_normalization_from_arrow();
-    void load_normalization_stats();
-    void load_all_parquet(const fs::path& data_dir);
+    std::pair<RunningStats, RunningStats> compute_stats(const std::vector<size_t>& files);
+    // previous: a stale manifest over the same columns and schema, or null
+    void load_normalization_stats(const std::vector<ManifestFile>& current,
+                                  const DatasetManifest* previous);
+    void apply_normalization_stats();  // STATE_MEAN etc. from state_stats_/action_stats_
+    void save_manifest(std::vector<ManifestFile> files, uint64_t fingerprint, uint64_t schema_hash);
+    void load_all_parquet();
     void load_video(const fs::path& video_dir);
-    void build_episode_index();
+    void load(const fs::path& root);
+    void open_parquet_stream(const DatasetManifest* manifest);  // row layout from manifest if given
+    void build_episode_index(const fs::path& meta_dir);
+    void build_column_store();
+    void visit_tables(const std::vector<std::string>& columns,
+                      const std::function<void(const arrow::Table&)>& fn);
+    std::pair<size_t, size_t> locate(size_t global_index) const;  // (chunk, local row)
+    std::string video_path_for_chunk(size_t chunk_idx) const;
+    Frame read_frame(size_t global_index, bool with_images);
+    torch::Tensor gather_rows(const torch::Tensor& rows, bool state);  // [n] -> [n, dim]
     cv::Mat decode_frame(const std::string& video_path, double timestamp_sec);
 };
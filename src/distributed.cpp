@@ -0,0 +1,170 @@
+#include "distributed.h"
+#include <torch/csrc/distributed/c10d/FileStore.hpp>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static int env_int(const char* name, int fallback) {
+    const char* v = std::getenv(name);
+    return v ? std::atoi(v) : fallback;
+}
+
+// --- DistributedContext ---
+
+DistributedContext init_distributed() {
+    DistributedContext ctx;
+    ctx.rank = env_int("LEROBOT_RANK", 0);
+    ctx.world_size = env_int("LEROBOT_WORLD_SIZE", 1);
+    if (ctx.world_size <= 1) return ctx;
+
+    const char* store_path = std::getenv("LEROBOT_STORE");
+    if (!store_path) throw std::runtime_error("LEROBOT_STORE not set for rank " + std::to_string(ctx.rank));
+    auto store = c10::make_intrusive<c10d::FileStore>(store_path, ctx.world_size);
+    auto options = c10d::ProcessGroupGloo::Options::create();
+    options->devices.push_back(c10d::ProcessGroupGloo::createDeviceForHostname("127.0.0.1"));
+    ctx.group = c10::make_intrusive<c10d::ProcessGroupGloo>(store, ctx.rank, ctx.world_size, options);
+    return ctx;
+}
+
+void DistributedContext::broadcast(std::vector<torch::Tensor> tensors, int root) {
+    if (!group) return;
+    c10d::BroadcastOptions opts;
+    opts.rootRank = root;
+    for (auto& t : tensors) {
+        std::vector<torch::Tensor> one{t};
+        group->broadcast(one, opts)->wait();
+    }
+}
+
+double DistributedContext::sum(double value) {
+    if (!group) return value;
+    std::vector<torch::Tensor> t{torch::tensor({value}, torch::kFloat64)};
+    group->allreduce(t)->wait();
+    return t[0].item<double>();
+}
+
+void DistributedContext::barrier() {
+    if (group) group->barrier()->wait();
+}
+
+// --- Launcher ---
+
+int launch_workers(int world_size, char** argv) {
+    fs::path store = fs::temp_directory_path() / ("lerobot_store_" + std::to_string(::getpid()));
+    fs::remove(store);
+
+    std::vector<pid_t> pids;
+    for (int rank = 0; rank < world_size; ++rank) {
+        pid_t pid = ::fork();
+        if (pid < 0) throw std::runtime_error("fork failed");
+        if (pid == 0) {
+            ::setenv("LEROBOT_RANK", std::to_string(rank).c_str(), 1);
+            ::setenv("LEROBOT_WORLD_SIZE", std::to_string(world_size).c_str(), 1);
+            ::setenv("LEROBOT_STORE", store.c_str(), 1);
+            ::execv("/proc/self/exe", argv);
+            std::perror("execv");
+            std::_Exit(127);
+        }
+        pids.push_back(pid);
+    }
+
+    int result = 0;
+    for (size_t done = 0; done < pids.size(); ++done) {
+        int status = 0;
+        pid_t pid = ::wait(&status);
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        if (code != 0 && result == 0) {
+            result = code;
+            std::cerr << "Worker " << pid << " failed (" << code << "), stopping the others\n";
+            for (pid_t other : pids)
+                if (other != pid) ::kill(other, SIGTERM);
+        }
+    }
+    fs::remove(store);
+    return result;
+}
+
+// --- GradientBucketer ---
+
+GradientBucketer::GradientBucketer(DistributedContext& ctx, std::vector<torch::Tensor> params,
+                                   size_t bucket_bytes)
+    : ctx_(ctx), params_(std::move(params)), slot_(params_.size()) {
+    // reverse order: the head's gradients arrive first in backward
+    int64_t bucket_elems = 0;
+    for (size_t i = params_.size(); i-- > 0;) {
+        if (!params_[i].requires_grad()) continue;
+        if (buckets_.empty() || bucket_elems * sizeof(float) >= bucket_bytes) {
+            buckets_.emplace_back();
+            bucket_elems = 0;
+        }
+        auto& b = buckets_.back();
+        slot_[i] = {buckets_.size() - 1, b.params.size()};
+        b.params.push_back(i);
+        b.offsets.push_back(bucket_elems);
+        bucket_elems += params_[i].numel();
+    }
+    for (auto& b : buckets_) {
+        const size_t last = b.params.back();
+        b.buffer = torch::zeros({b.offsets.back() + params_[last].numel()}, torch::kFloat32);
+    }
+    if (!ctx_.group) return;
+
+    for (size_t i = 0; i < params_.size(); ++i) {
+        if (!params_[i].requires_grad()) continue;
+        hooks_.push_back(params_[i].register_hook([this, i](torch::Tensor grad) { on_grad(i, grad); }));
+    }
+}
+
+GradientBucketer::~GradientBucketer() {
+    size_t h = 0;
+    for (size_t i = 0; i < params_.size() && h < hooks_.size(); ++i)
+        if (params_[i].requires_grad()) params_[i].remove_hook(hooks_[h++]);
+}
+
+void GradientBucketer::on_grad(size_t param, const torch::Tensor& grad) {
+    auto [bi, pos] = slot_[param];
+    Bucket& b = buckets_[bi];
+    b.buffer.narrow(0, b.offsets[pos], grad.numel()).copy_(grad.reshape(-1));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (++b.ready == b.params.size()) launch_ready();
+}
+
+void GradientBucketer::launch_ready() {
+    while (next_launch_ < buckets_.size() && buckets_[next_launch_].ready == buckets_[next_launch_].params.size())
+        launch(buckets_[next_launch_++]);
+}
+
+void GradientBucketer::launch(Bucket& bucket) {
+    std::vector<torch::Tensor> tensors{bucket.buffer};
+    bucket.work = ctx_.group->allreduce(tensors);
+}
+
+void GradientBucketer::finish() {
+    if (!ctx_.group) return;
+    {
+        // parameters that got no gradient this step contribute zeros
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t bi = next_launch_; bi < buckets_.size(); ++bi) buckets_[bi].ready = buckets_[bi].params.size();
+        launch_ready();
+    }
+    for (auto& b : buckets_) {
+        b.work->wait();
+        b.buffer.div_(ctx_.world_size);
+        for (size_t k = 0; k < b.params.size(); ++k) {
+            auto& p = params_[b.params[k]];
+            auto avg = b.buffer.narrow(0, b.offsets[k], p.numel()).view_as(p);
+            if (p.grad().defined()) p.mutable_grad().copy_(avg);
+            else p.mutable_grad() = avg.clone();
+        }
+        b.buffer.zero_();
+        b.ready = 0;
+        b.work.reset();
+    }
+    next_launch_ = 0;
+}
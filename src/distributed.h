@@ -0,0 +1,71 @@
+#pragma once
+#include <torch/torch.h>
+#include <torch/csrc/distributed/c10d/ProcessGroupGloo.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Data-parallel training across local processes. The launcher re-executes
+// the current binary once per rank with LEROBOT_RANK / LEROBOT_WORLD_SIZE /
+// LEROBOT_STORE set; the workers rendezvous through a FileStore and talk
+// Gloo over the loopback interface only.
+
+struct DistributedContext {
+    int rank = 0;
+    int world_size = 1;
+    c10::intrusive_ptr<c10d::ProcessGroupGloo> group;  // null when world_size == 1
+
+    bool is_main() const { return rank == 0; }
+    void broadcast(std::vector<torch::Tensor> tensors, int root = 0);  // in place
+    double sum(double value);                                       // over ranks
+    void barrier();
+};
+
+// Rank/world size from the environment; builds the process group when the
+// world has more than one rank.
+DistributedContext init_distributed();
+
+// Run argv once per rank (world_size copies) and wait for all of them. A
+// failing rank terminates the others. Returns the first non-zero exit code.
+int launch_workers(int world_size, char** argv);
+
+// Averages gradients over ranks while backward is still running. Parameters
+// are grouped into ~bucket_bytes buckets in reverse registration order
+// (roughly the order backward produces their gradients). A grad hook copies
+// each gradient into its bucket, and a full bucket is all-reduced
+// asynchronously; buckets are launched strictly in order so every rank
+// issues the same collective sequence. finish() waits and writes the
+// averaged gradients back to .grad.
+class GradientBucketer {
+public:
+    GradientBucketer(DistributedContext& ctx, std::vector<torch::Tensor> params,
+                     size_t bucket_bytes = size_t(25) << 20);
+    ~GradientBucketer();
+    GradientBucketer(const GradientBucketer&) = delete;
+    GradientBucketer& operator=(const GradientBucketer&) = delete;
+
+    void finish();  // after loss.backward(), before optimizer.step()
+    size_t num_buckets() const { return buckets_.size(); }
+
+private:
+    struct Bucket {
+        std::vector<size_t> params;   // indices into params_
+        std::vector<int64_t> offsets; // element offset of each param in buffer
+        torch::Tensor buffer;         // flat float32
+        size_t ready = 0;
+        c10::intrusive_ptr<c10d::Work> work;
+    };
+
+    DistributedContext& ctx_;
+    std::vector<torch::Tensor> params_;
+    std::vector<std::pair<size_t, size_t>> slot_;  // param -> (bucket, position in bucket)
+    std::vector<Bucket> buckets_;
+    std::vector<unsigned> hooks_;
+    size_t next_launch_ = 0;
+    std::mutex mutex_;
+
+    void on_grad(size_t param, const torch::Tensor& grad);
+    void launch_ready();  // expects mutex_ held
+    void launch(Bucket& bucket);
+};
@@ -0,0 +1,79 @@
+#include "policy_export.h"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Usage: export_policy [checkpoint] [config] [out] [HxW] [tolerance]
+// Freezes checkpoints/act_final.pt into checkpoints/act_final.ts, checks the
+// optimized graph against the eager policy and compares their latency. The
+// tolerance is on the largest difference in normalized action units
+// (divided by action_std), since raw units can be pixels.
+int main(int argc, char** argv) {
+    fs::path checkpoint = argc > 1 ? argv[1] : "checkpoints/act_final.pt";
+    fs::path config_path = argc > 2 ? argv[2] : "checkpoints/act_config.json";
+    fs::path out = argc > 3 ? argv[3] : "checkpoints/act_final.ts";
+    int height = 96, width = 96;
+    if (argc > 4 && std::sscanf(argv[4], "%dx%d", &height, &width) != 2) {
+        std::cerr << "Size must look like 96x96, got " << argv[4] << "\n";
+        return 1;
+    }
+    double tolerance = argc > 5 ? std::stod(argv[5]) : 1e-4;
+
+    ACTConfig config = ACTConfig::load(config_path);
+    ACTPolicy policy = config.make_policy();
+    torch::load(policy, checkpoint);
+    policy->eval();
+
+    freeze_policy(policy, config).save(out.string());
+    std::cout << "Saved frozen policy to " << out << "\n";
+    auto scripted = load_optimized_policy(out);
+
+    torch::InferenceMode inference_mode;
+    auto eager = [&](const torch::Tensor& images, const torch::Tensor& state, const torch::Tensor& mask = {}) {
+        auto s = (state - config.state_mean) / (config.state_std + 1e-5);
+        return policy->forward(images, s, mask) * (config.action_std + 1e-5) + config.action_mean;
+    };
+    auto jit = [&](const torch::Tensor& images, const torch::Tensor& state, const torch::Tensor& mask = {}) {
+        if (mask.defined()) return scripted.forward({images, state, mask}).toTensor();
+        return scripted.forward({images, state}).toTensor();
+    };
+    auto action_scale = config.action_std + 1e-5;
+
+    // --- Equivalence ---
+    const int64_t T = config.image_deltas.size();
+    double max_diff = 0.0;
+    for (int64_t B : {1, 4, 32}) {
+        auto images = torch::randint(0, 256, {B, T, 3, height, width}, torch::kUInt8);
+        auto state = config.state_mean + config.state_std * torch::randn({B, config.state_dim});
+        double diff = ((eager(images, state) - jit(images, state)) / action_scale).abs().max().item<double>();
+        std::cout << "B=" << B << " max |eager - frozen| / action_std = " << diff << "\n";
+        max_diff = std::max(max_diff, diff);
+        if (T > 1) {  // oldest frame padded, as at the start of an episode
+            auto mask = torch::ones({B, T}, torch::kBool);
+            mask.select(1, 0).fill_(false);
+            diff = ((eager(images, state, mask) - jit(images, state, mask)) / action_scale).abs().max().item<double>();
+            std::cout << "B=" << B << " masked: " << diff << "\n";
+            max_diff = std::max(max_diff, diff);
+        }
+    }
+    const bool ok = max_diff <= tolerance;
+    std::cout << (ok ? "PASS" : "FAIL") << " (tolerance " << tolerance << ", normalized action units)\n";
+
+    // --- Latency, batch 1 ---
+    auto images = torch::randint(0, 256, {1, T, 3, height, width}, torch::kUInt8);
+    auto state = torch::randn({1, config.state_dim});
+    auto time_us = [&](auto&& fn) {
+        for (int i = 0; i < 20; ++i) fn(images, state);
+        const int iters = 200;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) fn(images, state);
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iters;
+    };
+    double eager_us = time_us(eager), jit_us = time_us(jit);
+    std::cout << std::fixed << std::setprecision(1) << "Latency (B=1, threads=" << torch::get_num_threads()
+              << "): eager " << eager_us << " us, frozen+optimized " << jit_us << " us ("
+              << std::setprecision(2) << eager_us / jit_us << "x)\n";
+    return ok ? 0 : 1;
+}
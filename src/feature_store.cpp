@@ -0,0 +1,159 @@
+#include "feature_store.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'L', 'R', 'F', 'E', 'A', 'T', 'S', '\0'};
+constexpr uint32_t VERSION = 2;
+constexpr uint64_t PAGE = 4096;
+constexpr int64_t IMAGE_TOKENS = 49;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t fp16;
+    uint64_t num_frames;
+    uint64_t tokens;
+    uint64_t hidden;
+    uint64_t backbone_fingerprint;
+    uint64_t dataset_fingerprint;  // LeRobotDataset::fingerprint of the data files
+    uint64_t data_offset;
+};
+
+}  // namespace
+
+// --- Build ---
+
+void FeatureStore::build(LeRobotDataset& dataset, ACTPolicy& policy, const fs::path& out_path, bool fp16,
+                         int64_t batch) {
+    const int64_t N = dataset.size().value();
+    const int64_t hidden = policy->hidden_dim;
+    fs::path tmp_path = out_path;
+    tmp_path += ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("FeatureStore: cannot write " + tmp_path.string());
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.fp16 = fp16;
+    header.num_frames = N;
+    header.tokens = IMAGE_TOKENS;
+    header.hidden = hidden;
+    header.backbone_fingerprint = policy->backbone_fingerprint();
+    header.dataset_fingerprint = dataset.fingerprint();
+    header.data_offset = PAGE;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.seekp(header.data_offset);
+
+    torch::InferenceMode inference_mode;
+    const bool was_training = policy->is_training();
+    policy->eval();
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t first = 0; first < N; first += batch) {
+        const int64_t n = std::min(batch, N - first);
+        // frames in row order, so each video decodes forward
+        auto images = dataset.load_window_images(torch::arange(first, first + n, torch::kInt64).view({n, 1}));
+        if (!images.defined())
+            throw std::runtime_error("FeatureStore: frames " + std::to_string(first) + ".." +
+                                     std::to_string(first + n) + " have no images");
+        auto tokens = policy->backbone(images.flatten(0, 1)).to(fp16 ? torch::kFloat16 : torch::kFloat32).contiguous();
+        out.write(static_cast<const char*>(tokens.data_ptr()), tokens.nbytes());
+        if ((first / batch) % 50 == 0)
+            std::cout << "  features: " << first + n << "/" << N << " frames, "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s\n";
+    }
+    policy->train(was_training);
+    out.close();
+    if (!out) throw std::runtime_error("FeatureStore: write failed for " + tmp_path.string());
+    fs::rename(tmp_path, out_path);
+
+    std::cout << "Feature store: " << N << " frames x " << IMAGE_TOKENS << " x " << hidden << " "
+              << (fp16 ? "fp16" : "fp32") << " (" << (fs::file_size(out_path) >> 20) << " MiB) → " << out_path
+              << "\n";
+}
+
+std::string FeatureStore::stale_reason(const fs::path& path, LeRobotDataset& dataset, ACTPolicy& policy,
+                                       bool fp16) {
+    if (!fs::exists(path)) return "missing";
+    try {
+        FeatureStore store(path);
+        if (store.num_frames() != int64_t(dataset.size().value()))
+            return "built for " + std::to_string(store.num_frames()) + " frames, dataset has " +
+                   std::to_string(dataset.size().value());
+        if (store.hidden() != policy->hidden_dim) return "hidden size differs";
+        if (store.backbone_fingerprint() != policy->backbone_fingerprint()) return "backbone weights changed";
+        if (store.dataset_fingerprint() != dataset.fingerprint()) return "dataset changed";
+        if (store.fp16() != fp16) return std::string("stored as ") + (store.fp16() ? "fp16" : "fp32");
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+    return "";
+}
+
+// --- Open ---
+
+FeatureStore::FeatureStore(const fs::path& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("FeatureStore: cannot open " + path.string());
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd_);
+        throw std::runtime_error("FeatureStore: bad file " + path.string());
+    }
+    mapped_bytes_ = st.st_size;
+    void* p = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("FeatureStore: mmap failed for " + path.string());
+    }
+    base_ = static_cast<uint8_t*>(p);
+
+    Header header;
+    std::memcpy(&header, base_, sizeof(Header));
+    const size_t elem = header.fp16 ? 2 : 4;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.tokens != IMAGE_TOKENS ||
+        header.data_offset + header.num_frames * header.tokens * header.hidden * elem > mapped_bytes_) {
+        unmap();
+        throw std::runtime_error("FeatureStore: not a feature store or truncated: " + path.string());
+    }
+    num_frames_ = header.num_frames;
+    hidden_ = header.hidden;
+    fp16_ = header.fp16;
+    backbone_fingerprint_ = header.backbone_fingerprint;
+    dataset_fingerprint_ = header.dataset_fingerprint;
+    tokens_ = torch::from_blob(base_ + header.data_offset, {num_frames_, IMAGE_TOKENS, hidden_},
+                               fp16_ ? torch::kFloat16 : torch::kFloat32);
+    ::madvise(base_, mapped_bytes_, MADV_RANDOM);  // samplers jump around; skip readahead
+}
+
+void FeatureStore::unmap() {
+    tokens_ = torch::Tensor();
+    if (base_) ::munmap(base_, mapped_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+}
+
+FeatureStore::~FeatureStore() { unmap(); }
+
+// --- Access ---
+
+torch::Tensor FeatureStore::gather(const torch::Tensor& rows) const {
+    PROFILE_SCOPE("features.gather");
+    auto flat = rows.flatten();
+    if (flat.numel() && (flat.min().item<int64_t>() < 0 || flat.max().item<int64_t>() >= num_frames_))
+        throw std::out_of_range("FeatureStore: row outside " + path_.string());
+    return tokens_.index_select(0, flat).to(torch::kFloat32).view({rows.size(0), rows.size(1), IMAGE_TOKENS, hidden_});
+}
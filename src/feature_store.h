@@ -0,0 +1,59 @@
+#pragma once
+#include "act_policy.h"
+#include "dataset.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Backbone tokens of every dataset frame, computed once and read through
+// mmap, so training with a frozen backbone never decodes video or runs the
+// convolutions.
+//
+// Layout: a fixed header, then page-aligned [num_frames, 49, hidden] tokens
+// in float32 or float16, row = global frame index. The header records the
+// fingerprint of the backbone weights that produced the tokens and of the
+// dataset's data files; stale_reason() compares them (and the precision)
+// with the current ones so a changed backbone or dataset invalidates the
+// store.
+class FeatureStore {
+public:
+    static constexpr const char* DEFAULT_NAME = "features.lrft";
+
+    // Run policy's backbone over frame 0..N of dataset, batch frames at a
+    // time, and write the store to out.
+    static void build(LeRobotDataset& dataset, ACTPolicy& policy, const fs::path& out, bool fp16 = false,
+                      int64_t batch = 256);
+
+    // Empty when the store at path matches policy's backbone, the dataset
+    // and the wanted precision, otherwise why it must be rebuilt
+    static std::string stale_reason(const fs::path& path, LeRobotDataset& dataset, ACTPolicy& policy,
+                                    bool fp16 = false);
+
+    explicit FeatureStore(const fs::path& path);
+    ~FeatureStore();
+    FeatureStore(const FeatureStore&) = delete;
+    FeatureStore& operator=(const FeatureStore&) = delete;
+
+    // rows [B, T] int64 -> [B, T, 49, hidden] float32, copied out of the mapping
+    torch::Tensor gather(const torch::Tensor& rows) const;
+
+    int64_t num_frames() const { return num_frames_; }
+    int64_t hidden() const { return hidden_; }
+    bool fp16() const { return fp16_; }
+    uint64_t backbone_fingerprint() const { return backbone_fingerprint_; }
+    uint64_t dataset_fingerprint() const { return dataset_fingerprint_; }
+
+private:
+    fs::path path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    torch::Tensor tokens_;  // [num_frames, 49, hidden] view of the mapping
+    int64_t num_frames_ = 0, hidden_ = 0;
+    bool fp16_ = false;
+    uint64_t backbone_fingerprint_ = 0, dataset_fingerprint_ = 0;
+
+    void unmap();
+};
@@ -0,0 +1,231 @@
+#include "frame_store.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'L', 'R', 'F', 'R', 'A', 'M', 'E', 'S'};
+constexpr uint32_t VERSION = 2;
+constexpr uint64_t PAGE = 4096;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t height, width, channels;
+    uint64_t num_frames;
+    uint64_t num_videos;
+    uint64_t data_offset;
+    uint64_t index_offset;
+};
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+T read_pod(const uint8_t*& p, const uint8_t* end) {
+    if (p + sizeof(T) > end) throw std::runtime_error("FrameStore: truncated index");
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+}
+
+}  // namespace
+
+// --- Build ---
+
+void FrameStore::build(const fs::path& dataset_root, const fs::path& out_path,
+                       int height, int width) {
+    std::vector<fs::path> videos;
+    for (const auto& cam_dir : fs::directory_iterator(dataset_root / "videos")) {
+        if (!cam_dir.is_directory()) continue;
+        for (const auto& chunk_dir : fs::directory_iterator(cam_dir)) {
+            if (!chunk_dir.is_directory()) continue;
+            for (const auto& file : fs::directory_iterator(chunk_dir))
+                if (file.path().extension() == ".mp4") videos.push_back(file.path());
+        }
+    }
+    std::sort(videos.begin(), videos.end());
+
+    fs::path tmp_path = out_path;
+    tmp_path += ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("FrameStore: cannot write " + tmp_path.string());
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.data_offset = PAGE;
+    out.seekp(header.data_offset);
+
+    std::vector<std::pair<std::string, Entry>> index;
+    cv::Size size(width, height);
+    int channels = 0;
+    int64_t total = 0;
+
+    for (const auto& video : videos) {
+        cv::VideoCapture cap(video.string());
+        if (!cap.isOpened()) {
+            std::cerr << "Failed to open video: " << video << "\n";
+            continue;
+        }
+        Entry entry{total, 0, fs::file_size(video), fs::last_write_time(video).time_since_epoch().count()};
+        cv::Mat frame;
+        while (cap.read(frame)) {
+            if (size.area() == 0) size = frame.size();
+            if (channels == 0) channels = frame.channels();
+            if (frame.channels() != channels)
+                throw std::runtime_error("FrameStore: mixed channel counts in " + video.string());
+            if (frame.size() != size) cv::resize(frame, frame, size, 0, 0, cv::INTER_AREA);
+            if (!frame.isContinuous()) frame = frame.clone();
+            out.write(reinterpret_cast<const char*>(frame.data), frame.total() * frame.elemSize());
+            ++entry.count;
+        }
+        total += entry.count;
+        index.emplace_back(video.lexically_relative(dataset_root).string(), entry);
+        std::cout << "  " << video.filename().string() << ": " << entry.count << " frames\n";
+    }
+
+    header.height = size.height;
+    header.width = size.width;
+    header.channels = channels;
+    header.num_frames = total;
+    header.num_videos = index.size();
+    header.index_offset = out.tellp();
+    for (const auto& [name, entry] : index) {
+        write_pod(out, static_cast<uint32_t>(name.size()));
+        out.write(name.data(), name.size());
+        write_pod(out, entry.first);
+        write_pod(out, entry.count);
+        write_pod(out, entry.source_size);
+        write_pod(out, entry.source_mtime);
+    }
+    out.seekp(0);
+    write_pod(out, header);
+    out.close();
+    if (!out) throw std::runtime_error("FrameStore: write failed for " + tmp_path.string());
+    fs::rename(tmp_path, out_path);
+
+    std::cout << "Frame store: " << index.size() << " videos, " << total << " frames of "
+              << size.width << "x" << size.height << "x" << channels << " → " << out_path << "\n";
+}
+
+// --- Open ---
+
+FrameStore::FrameStore(const fs::path& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("FrameStore: cannot open " + path.string());
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd_);
+        throw std::runtime_error("FrameStore: bad file " + path.string());
+    }
+    mapped_bytes_ = st.st_size;
+    void* p = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("FrameStore: mmap failed for " + path.string());
+    }
+    base_ = static_cast<uint8_t*>(p);
+
+    try {
+        parse_index();
+    } catch (...) {
+        unmap();
+        throw;
+    }
+    ::madvise(base_, mapped_bytes_, MADV_RANDOM);  // samplers jump around; skip readahead
+}
+
+void FrameStore::parse_index() {
+    Header header;
+    std::memcpy(&header, base_, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+        throw std::runtime_error("FrameStore: not a frame store: " + path_.string());
+    height_ = header.height;
+    width_ = header.width;
+    channels_ = header.channels;
+    frame_bytes_ = size_t(height_) * width_ * channels_;
+    data_offset_ = header.data_offset;
+    if (header.index_offset > mapped_bytes_ ||
+        data_offset_ + header.num_frames * frame_bytes_ > header.index_offset)
+        throw std::runtime_error("FrameStore: truncated file " + path_.string());
+
+    const uint8_t* p = base_ + header.index_offset;
+    const uint8_t* end = base_ + mapped_bytes_;
+    for (uint64_t v = 0; v < header.num_videos; ++v) {
+        auto len = read_pod<uint32_t>(p, end);
+        if (p + len > end) throw std::runtime_error("FrameStore: truncated index");
+        std::string name(reinterpret_cast<const char*>(p), len);
+        p += len;
+        Entry e;
+        e.first = read_pod<int64_t>(p, end);
+        e.count = read_pod<int64_t>(p, end);
+        e.source_size = read_pod<uint64_t>(p, end);
+        e.source_mtime = read_pod<int64_t>(p, end);
+        videos_.emplace(std::move(name), e);
+    }
+}
+
+void FrameStore::unmap() {
+    if (base_) ::munmap(base_, mapped_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+}
+
+FrameStore::~FrameStore() { unmap(); }
+
+std::vector<std::string> FrameStore::drop_stale(const fs::path& dataset_root) {
+    std::vector<std::string> stale;
+    for (auto it = videos_.begin(); it != videos_.end();) {
+        const fs::path source = dataset_root / it->first;
+        std::error_code ec;
+        const auto size = fs::file_size(source, ec);
+        const auto mtime = ec ? 0 : fs::last_write_time(source, ec).time_since_epoch().count();
+        if (ec || size != it->second.source_size || mtime != it->second.source_mtime) {
+            stale.push_back(it->first);
+            it = videos_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::sort(stale.begin(), stale.end());
+    return stale;
+}
+
+// --- Access ---
+
+int64_t FrameStore::num_frames(const std::string& video) const {
+    auto it = videos_.find(video);
+    return it == videos_.end() ? 0 : it->second.count;
+}
+
+const uint8_t* FrameStore::frame_ptr(const std::string& video, int64_t frame_idx, int64_t count) const {
+    auto it = videos_.find(video);
+    if (it == videos_.end() || frame_idx < 0 || count <= 0 || frame_idx + count > it->second.count)
+        return nullptr;
+    return base_ + data_offset_ + (it->second.first + frame_idx) * frame_bytes_;
+}
+
+cv::Mat FrameStore::frame(const std::string& video, int64_t frame_idx) const {
+    const uint8_t* p = frame_ptr(video, frame_idx);
+    if (!p) return cv::Mat();
+    return cv::Mat(height_, width_, CV_8UC(channels_), const_cast<uint8_t*>(p));
+}
+
+torch::Tensor FrameStore::frames(const std::string& video, int64_t first, int64_t count) const {
+    const uint8_t* p = frame_ptr(video, first, count);
+    if (!p) return torch::Tensor();
+    return torch::from_blob(const_cast<uint8_t*>(p), {count, height_, width_, channels_}, torch::kUInt8);
+}
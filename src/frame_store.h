@@ -0,0 +1,71 @@
+#pragma once
+#include <torch/torch.h>
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Pre-decoded video frames in one flat file, read through mmap.
+//
+// Layout: a fixed header, the uint8 frames (H x W x C, BGR as decoded,
+// page-aligned), then an index mapping each video (path relative to the
+// dataset root) to its first frame, frame count and the size and mtime of
+// the source file it was decoded from. Opening maps the file and parses
+// only the header and index, and every reader of the same file shares the
+// page cache.
+class FrameStore {
+public:
+    static constexpr const char* DEFAULT_NAME = "frames.lrfs";
+
+    // Decode every videos/<camera>/<chunk>/*.mp4 under dataset_root into out.
+    // height/width of 0 keep the size of the first decoded frame.
+    static void build(const fs::path& dataset_root, const fs::path& out,
+                      int height = 0, int width = 0);
+
+    explicit FrameStore(const fs::path& path);
+    ~FrameStore();
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    // Forget the videos whose source under dataset_root is gone or differs in
+    // size or mtime from when the store was built, so they are decoded again;
+    // returns their names.
+    std::vector<std::string> drop_stale(const fs::path& dataset_root);
+
+    bool contains(const std::string& video) const { return videos_.count(video) > 0; }
+    int64_t num_frames(const std::string& video) const;
+
+    // Zero-copy, read-only views into the mapping; empty/undefined when the
+    // video or frame is unknown. Writing into them faults.
+    cv::Mat frame(const std::string& video, int64_t frame_idx) const;
+    torch::Tensor frames(const std::string& video, int64_t first, int64_t count) const;  // [n, H, W, C]
+
+    int height() const { return height_; }
+    int width() const { return width_; }
+    int channels() const { return channels_; }
+
+private:
+    struct Entry {
+        int64_t first = 0;
+        int64_t count = 0;
+        uint64_t source_size = 0;
+        int64_t source_mtime = 0;  // file_time_type ticks
+    };
+
+    fs::path path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    uint64_t data_offset_ = 0;
+    int height_ = 0, width_ = 0, channels_ = 0;
+    size_t frame_bytes_ = 0;
+    std::unordered_map<std::string, Entry> videos_;
+
+    void parse_index();
+    void unmap();
+    const uint8_t* frame_ptr(const std::string& video, int64_t frame_idx, int64_t count = 1) const;
+};
@@ -0,0 +1,91 @@
+#include "fused_encoder.h"
+
+namespace {
+
+// y + x, written into y unless that would change the result dtype (under
+// autocast a bf16 GEMM output meets an fp32 residual)
+torch::Tensor add_residual(torch::Tensor y, const torch::Tensor& x) {
+    return y.scalar_type() == x.scalar_type() ? y.add_(x) : y + x;
+}
+
+}  // namespace
+
+// --- FusedSelfAttention ---
+
+FusedSelfAttentionImpl::FusedSelfAttentionImpl(int64_t embed_dim, int64_t heads, double dropout)
+    : embed_dim(embed_dim), heads(heads), dropout(dropout) {
+    if (embed_dim % heads != 0) throw std::invalid_argument("FusedSelfAttention: embed_dim must divide by heads");
+    reset();
+}
+
+// same order (and so the same draws) as torch::nn::MultiheadAttention
+void FusedSelfAttentionImpl::reset() {
+    in_proj_weight = register_parameter("in_proj_weight", torch::empty({3 * embed_dim, embed_dim}));
+    in_proj_bias = register_parameter("in_proj_bias", torch::empty({3 * embed_dim}));
+    out_proj = register_module("out_proj", torch::nn::Linear(embed_dim, embed_dim));
+    torch::nn::init::xavier_uniform_(in_proj_weight);
+    torch::nn::init::constant_(in_proj_bias, 0.0);
+    torch::nn::init::constant_(out_proj->bias, 0.0);
+}
+
+torch::Tensor FusedSelfAttentionImpl::forward(const torch::Tensor& x, const torch::Tensor& allowed) {
+    const int64_t B = x.size(0), L = x.size(1);
+    // one GEMM for q, k and v, split by views: [3, B, heads, L, head_dim]
+    auto qkv = torch::linear(x, in_proj_weight, in_proj_bias)
+                   .view({B, L, 3, heads, embed_dim / heads})
+                   .permute({2, 0, 3, 1, 4});
+    auto out = at::scaled_dot_product_attention(qkv[0], qkv[1], qkv[2],
+                                                allowed.defined() ? c10::optional<torch::Tensor>(allowed) : c10::nullopt,
+                                                is_training() ? dropout : 0.0);
+    return out_proj(out.transpose(1, 2).reshape({B, L, embed_dim}));
+}
+
+// --- FusedEncoderLayer ---
+
+FusedEncoderLayerImpl::FusedEncoderLayerImpl(int64_t d_model, int64_t heads, int64_t dim_feedforward,
+                                             double dropout)
+    : d_model(d_model), heads(heads), dim_feedforward(dim_feedforward), dropout(dropout) {
+    reset();
+}
+
+void FusedEncoderLayerImpl::reset() {
+    self_attn = register_module("self_attn", FusedSelfAttention(d_model, heads, dropout));
+    linear1 = register_module("linear1", torch::nn::Linear(d_model, dim_feedforward));
+    linear2 = register_module("linear2", torch::nn::Linear(dim_feedforward, d_model));
+    norm1 = register_module("norm1", torch::nn::LayerNorm(torch::nn::LayerNormOptions({d_model})));
+    norm2 = register_module("norm2", torch::nn::LayerNorm(torch::nn::LayerNormOptions({d_model})));
+}
+
+// post-norm, as torch::nn::TransformerEncoderLayer:
+//   x = norm1(x + dropout(attn(x))); x = norm2(x + dropout(linear2(dropout(relu(linear1(x))))))
+torch::Tensor FusedEncoderLayerImpl::forward(const torch::Tensor& x, const torch::Tensor& allowed) {
+    const bool drop = is_training() && dropout > 0.0;
+    auto a = self_attn(x, allowed);
+    if (drop) a = torch::dropout(a, dropout, true);
+    auto y = norm1(add_residual(a, x));
+
+    auto h = linear1(y).relu_();
+    if (drop) h = torch::dropout(h, dropout, true);
+    auto f = linear2(h);
+    if (drop) f = torch::dropout(f, dropout, true);
+    return norm2(add_residual(f, y));
+}
+
+// --- FusedEncoder ---
+
+FusedEncoderImpl::FusedEncoderImpl(int64_t d_model, int64_t heads, int64_t num_layers, int64_t dim_feedforward,
+                                   double dropout)
+    : heads(heads) {
+    FusedEncoderLayer layer(d_model, heads, dim_feedforward, dropout);
+    layers = register_module("layers", torch::nn::ModuleList());
+    for (int64_t i = 0; i < num_layers; ++i) layers->push_back(layer->clone());
+}
+
+torch::Tensor FusedEncoderImpl::forward(const torch::Tensor& x, const torch::Tensor& key_padding_mask) {
+    torch::Tensor allowed;  // SDPA's bool mask is the inverse: true = attend
+    if (key_padding_mask.defined())
+        allowed = key_padding_mask.logical_not().view({x.size(0), 1, 1, x.size(1)});
+    auto out = x;
+    for (const auto& layer : *layers) out = layer->as<FusedEncoderLayerImpl>()->forward(out, allowed);
+    return out;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <torch/torch.h>
+
+// Drop-in replacement for torch::nn::TransformerEncoder with post-norm ReLU
+// layers, specialised for ACT's short token sequences (~50-100 tokens).
+// Batch-first [B, L, E] throughout: one GEMM for the packed QKV projection,
+// fused scaled_dot_product_attention instead of per-head bmm + softmax, and
+// in-place epilogues (bias/ReLU/residual) so each layer allocates little
+// beyond its GEMM outputs. Parameters carry the same names and shapes as
+// the generic module (layers.<i>.self_attn.in_proj_weight, .linear1, .norm1,
+// ...), so existing checkpoints load unchanged, and outputs match it up to
+// float rounding.
+
+// Self-attention with torch::nn::MultiheadAttention's parameter layout
+struct FusedSelfAttentionImpl : torch::nn::Cloneable<FusedSelfAttentionImpl> {
+    FusedSelfAttentionImpl(int64_t embed_dim, int64_t heads, double dropout);
+    void reset() override;
+
+    // x [B, L, E]; allowed [B, 1, 1, L] bool (true = attend) or undefined
+    torch::Tensor forward(const torch::Tensor& x, const torch::Tensor& allowed);
+
+    int64_t embed_dim, heads;
+    double dropout;
+    torch::Tensor in_proj_weight;  // [3E, E], rows q | k | v
+    torch::Tensor in_proj_bias;    // [3E]
+    torch::nn::Linear out_proj{nullptr};
+};
+TORCH_MODULE(FusedSelfAttention);
+
+struct FusedEncoderLayerImpl : torch::nn::Cloneable<FusedEncoderLayerImpl> {
+    FusedEncoderLayerImpl(int64_t d_model, int64_t heads, int64_t dim_feedforward = 2048, double dropout = 0.1);
+    void reset() override;
+
+    torch::Tensor forward(const torch::Tensor& x, const torch::Tensor& allowed);
+
+    int64_t d_model, heads, dim_feedforward;
+    double dropout;
+    FusedSelfAttention self_attn{nullptr};
+    torch::nn::Linear linear1{nullptr}, linear2{nullptr};
+    torch::nn::LayerNorm norm1{nullptr}, norm2{nullptr};
+};
+TORCH_MODULE(FusedEncoderLayer);
+
+struct FusedEncoderImpl : torch::nn::Module {
+    // num_layers copies of one initialized layer, as TransformerEncoder does
+    FusedEncoderImpl(int64_t d_model, int64_t heads, int64_t num_layers, int64_t dim_feedforward = 2048,
+                     double dropout = 0.1);
+
+    // x [B, L, E]; key_padding_mask [B, L] bool, true = padding, may be undefined
+    torch::Tensor forward(const torch::Tensor& x, const torch::Tensor& key_padding_mask = {});
+
+    int64_t heads;
+    torch::nn::ModuleList layers;
+};
+TORCH_MODULE(FusedEncoder);
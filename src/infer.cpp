@@ -0,0 +1,238 @@
+#include "act_policy.h"
+#include "policy_export.h"
+#include "dataset.h"
+#include "profiler.h"
+#include <torch/torch.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+
+// Usage: infer [--checkpoint checkpoints/act_final.pt] [--config checkpoints/act_config.json]
+//              [--replay <dataset_root>] [--episode 0] [--steps 1000] [--warmup 50]
+//              [--threads 1] [--stride 1] [--no-ensemble] [--size 96x96]
+//              [--script checkpoints/act_final.ts] [--streaming]
+//
+// Runs the trained policy one control tick at a time and reports latency.
+// Inputs come from a recorded episode (--replay, frames decoded up front so
+// decoding stays out of the measurement) or from random synthetic frames.
+// --script runs a frozen export (see export_policy) instead of the eager
+// module; normalization then happens inside the graph. --streaming feeds
+// the eager policy one camera frame per tick through StreamingPolicy, which
+// encodes each frame once and reuses its tokens for the later history slots.
+
+namespace {
+
+struct Options {
+    std::string checkpoint = "checkpoints/act_final.pt";
+    std::string config = "checkpoints/act_config.json";
+    std::string replay;
+    std::string script;
+    size_t episode = 0;
+    int64_t steps = 1000;
+    int warmup = 50;
+    int threads = 1;
+    int stride = 1;
+    bool ensemble = true;
+    bool streaming = false;
+    int height = 96, width = 96;
+};
+
+Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--checkpoint") o.checkpoint = value();
+        else if (arg == "--config") o.config = value();
+        else if (arg == "--replay") o.replay = value();
+        else if (arg == "--script") o.script = value();
+        else if (arg == "--episode") o.episode = std::stoul(value());
+        else if (arg == "--steps") o.steps = std::stoll(value());
+        else if (arg == "--warmup") o.warmup = std::stoi(value());
+        else if (arg == "--threads") o.threads = std::stoi(value());
+        else if (arg == "--stride") o.stride = std::stoi(value());
+        else if (arg == "--no-ensemble") o.ensemble = false;
+        else if (arg == "--streaming") o.streaming = true;
+        else if (arg == "--size") {
+            auto v = value();
+            if (std::sscanf(v.c_str(), "%dx%d", &o.height, &o.width) != 2)
+                throw std::invalid_argument("Size must look like 96x96, got " + v);
+        } else {
+            throw std::invalid_argument("Unknown argument " + arg);
+        }
+    }
+    return o;
+}
+
+// Observations to feed, one row per tick
+struct Episode {
+    torch::Tensor images;   // [N, T, 3, H, W] uint8
+    torch::Tensor states;   // [N, state_dim] float32
+    torch::Tensor actions;  // [N, action_dim] float32, undefined for synthetic input
+    std::vector<double> timestamps;  // [N] capture times, seconds
+    double fps = 30.0;
+};
+
+Episode load_replay(const Options& o, const ACTConfig& config) {
+    LeRobotDataset dataset(o.replay, {{"observation.image", config.image_deltas}});
+    auto [first, end] = dataset.episode_range(o.episode);
+    std::cout << "Replaying episode " << o.episode << ": frames " << first << ".." << end << "\n";
+    Batch b = dataset.load_episode(o.episode);
+    if (!b.images.defined()) throw std::runtime_error("Episode " + std::to_string(o.episode) + " has no images");
+    const double* ts = b.timestamp.data_ptr<double>();
+    return {b.images, b.state, b.action, std::vector<double>(ts, ts + b.timestamp.numel()), dataset.fps()};
+}
+
+Episode synthetic(const Options& o, const ACTConfig& config) {
+    const int64_t N = 64, T = config.image_deltas.size();
+    const double fps = 30.0;
+    std::vector<double> timestamps;
+    for (int64_t i = 0; i < N; ++i) timestamps.push_back(i / fps);
+    return {torch::randint(0, 256, {N, T, 3, o.height, o.width}, torch::kUInt8),
+            torch::randn({N, config.state_dim}), {}, timestamps, fps};
+}
+
+// latencies in microseconds
+void report(const std::string& name, const std::vector<double>& us) {
+    if (us.empty()) return;
+    auto sorted = us;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = std::accumulate(us.begin(), us.end(), 0.0) / us.size();
+    double var = 0.0, delta = 0.0;
+    for (size_t i = 0; i < us.size(); ++i) {
+        var += (us[i] - mean) * (us[i] - mean);
+        if (i) delta += std::abs(us[i] - us[i - 1]);
+    }
+    std::cout << std::fixed << std::setprecision(1) << name << " (" << us.size() << " samples, us): "
+              << "mean " << mean << "  p50 " << percentile(sorted, 0.50)
+              << "  p99 " << percentile(sorted, 0.99) << "  p99.9 " << percentile(sorted, 0.999)
+              << "  max " << sorted.back() << "\n  jitter: stddev " << std::sqrt(var / us.size())
+              << "  mean |step-to-step| " << (us.size() > 1 ? delta / (us.size() - 1) : 0.0)
+              << "  p99.9-p50 " << percentile(sorted, 0.999) - percentile(sorted, 0.50) << "\n"
+              << std::defaultfloat;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (o.streaming && !o.script.empty()) {
+        std::cerr << "--streaming runs the eager policy, drop --script\n";
+        return 1;
+    }
+
+    // Fixed thread counts: intra-op for the kernels, no inter-op pool
+    torch::set_num_threads(o.threads);
+    at::set_num_interop_threads(1);
+
+    ACTConfig config = ACTConfig::load(o.config);
+    ACTPolicy policy = config.make_policy();
+    torch::jit::Module scripted;
+    if (o.script.empty()) {
+        torch::load(policy, o.checkpoint);
+        policy->eval();
+    } else {
+        scripted = load_optimized_policy(o.script);
+    }
+    std::cout << "Loaded " << (o.script.empty() ? o.checkpoint : o.script) << " (chunk_size=" << config.chunk_size << ", T="
+              << config.image_deltas.size() << ", threads=" << torch::get_num_threads() << ")\n";
+
+    Episode episode = o.replay.empty() ? synthetic(o, config) : load_replay(o, config);
+    const int64_t N = episode.states.size(0);
+    if (N == 0) {
+        std::cerr << "Nothing to replay\n";
+        return 1;
+    }
+
+    torch::InferenceMode inference_mode;
+
+    // --- Buffers reused every tick ---
+    auto images = torch::empty_like(episode.images[0]).unsqueeze(0);  // [1, T, 3, H, W]
+    auto image_mask = torch::ones({1, images.size(1)}, torch::kBool);
+    auto state = torch::empty({1, config.state_dim});
+    auto norm_state = torch::empty({1, config.state_dim});
+    auto action = torch::empty({config.action_dim});
+    auto image_in = images[0];  // views created once, outside the tick
+    auto state_in = state[0];
+    auto state_scale = config.state_std + 1e-5;
+    auto action_scale = config.action_std + 1e-5;
+
+    ChunkExecutorOptions exec_opts;
+    exec_opts.replan_stride = o.stride;
+    exec_opts.ensemble = o.ensemble;
+    ChunkExecutor executor(config.chunk_size, exec_opts);
+    StreamingOptions stream_opts;
+    stream_opts.fps = episode.fps;
+    StreamingPolicy streamer(policy, config.image_deltas, stream_opts);
+    const int64_t newest = images.size(1) - 1;
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> step_us, plan_us;
+    step_us.reserve(o.steps);
+    plan_us.reserve(o.steps);
+    double sq_err = 0.0;
+
+    // one control tick: observation in, action out
+    auto tick = [&](int64_t i, bool timed) {
+        auto start = Clock::now();
+        image_in.copy_(episode.images[i]);
+        state_in.copy_(episode.states[i]);
+        if (o.streaming) streamer.observe(image_in[newest], episode.timestamps[i]);  // every frame, planned or not
+        if (executor.needs_plan()) {
+            auto plan_start = Clock::now();
+            torch::Tensor chunk;
+            if (o.script.empty()) {
+                torch::sub_out(norm_state, state, config.state_mean).div_(state_scale);
+                chunk = o.streaming ? streamer.plan(norm_state[0]) : policy->forward(images, norm_state, image_mask)[0];
+                chunk.mul_(action_scale).add_(config.action_mean);
+            } else {
+                chunk = scripted.forward({images, state}).toTensor()[0];
+            }
+            executor.add_plan(chunk);
+            if (timed) plan_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - plan_start).count());
+        }
+        action.copy_(executor.step());
+        if (timed) step_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    };
+
+    for (int w = 0; w < o.warmup; ++w) tick(w % N, false);
+    executor.reset();
+    streamer.reset();
+
+    const int64_t steps = o.replay.empty() ? o.steps : std::min<int64_t>(o.steps, N);
+    for (int64_t s = 0; s < steps; ++s) {
+        tick(s % N, true);
+        if (episode.actions.defined())
+            sq_err += (action - episode.actions[s]).pow(2).mean().item<double>();
+    }
+
+    report("Step latency", step_us);
+    report("Policy forward", plan_us);
+    std::cout << "Policy evaluated " << plan_us.size() << " times over " << steps << " ticks\n";
+    if (o.streaming) {
+        const auto& ss = streamer.stats();
+        std::cout << "Streaming: " << ss.encoded << " frames encoded for " << ss.plans << " plans ("
+                  << config.image_deltas.size() << " history frames each), " << ss.repeated << " repeated, "
+                  << ss.dropped << " dropped, " << ss.substituted << " substituted, " << ss.padded
+                  << " padded slots, " << ss.resets << " resets\n";
+    }
+    if (episode.actions.defined())
+        std::cout << "Action MSE vs recorded: " << sq_err / steps << "\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "synthetic_dataset.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Usage: make_synthetic_dataset <out_root> [--episodes 20] [--frames 200] [--size 96x96]
+//                               [--fps 10] [--state-dim 2] [--action-dim 2]
+//                               [--row-group 0] [--seed 0] [--no-video]
+// Writes a Push-T shaped dataset (Parquet chunks, MP4s, meta/) of any size,
+// for benchmarks and tests without the real download.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <out_root> [--episodes N] [--frames N] [--size HxW] [--fps F]"
+                  << " [--state-dim N] [--action-dim N] [--row-group N] [--seed N] [--no-video]\n";
+        return 1;
+    }
+    fs::path root(argv[1]);
+    SyntheticDatasetOptions o;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--no-video") {
+                o.videos = false;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            std::string v = argv[++i];
+            if (arg == "--episodes") o.episodes = std::stoi(v);
+            else if (arg == "--frames") o.frames_per_episode = std::stoi(v);
+            else if (arg == "--fps") o.fps = std::stod(v);
+            else if (arg == "--state-dim") o.state_dim = std::stoi(v);
+            else if (arg == "--action-dim") o.action_dim = std::stoi(v);
+            else if (arg == "--row-group") o.row_group_rows = std::stoll(v);
+            else if (arg == "--seed") o.seed = std::stoull(v);
+            else if (arg == "--size") {
+                if (std::sscanf(v.c_str(), "%dx%d", &o.height, &o.width) != 2)
+                    throw std::invalid_argument("Size must look like 96x96, got " + v);
+            } else {
+                throw std::invalid_argument("Unknown argument " + arg);
+            }
+        }
+        write_synthetic_dataset(root, o);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "manifest.h"
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/schema.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'L', 'R', 'M', 'A', 'N', 'I', 'F', 'T'};
+constexpr uint32_t VERSION = 2;
+
+template <typename T>
+void write_pod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+T read_pod(std::istream& in) {
+    T v{};
+    if (!in.read(reinterpret_cast<char*>(&v), sizeof(T))) throw std::runtime_error("manifest truncated");
+    return v;
+}
+
+void write_string(std::ostream& out, const std::string& s) {
+    write_pod<uint64_t>(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+std::string read_string(std::istream& in) {
+    const auto n = read_pod<uint64_t>(in);
+    if (n > (uint64_t(1) << 20)) throw std::runtime_error("manifest corrupt");
+    std::string s(n, '\0');
+    if (!in.read(s.data(), n)) throw std::runtime_error("manifest truncated");
+    return s;
+}
+
+template <typename T>
+void write_vector(std::ostream& out, const std::vector<T>& v) {
+    write_pod<uint64_t>(out, v.size());
+    for (const auto& x : v) write_pod<uint64_t>(out, x);
+}
+
+template <typename T>
+std::vector<T> read_vector(std::istream& in) {
+    const auto n = read_pod<uint64_t>(in);
+    if (n > (uint64_t(1) << 32)) throw std::runtime_error("manifest corrupt");
+    std::vector<T> v(n);
+    for (auto& x : v) x = static_cast<T>(read_pod<uint64_t>(in));
+    return v;
+}
+
+struct Fnv1a {
+    uint64_t h = 1469598103934665603ull;
+    void add(const void* data, size_t n) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    }
+    void add(const std::string& s) {
+        add(s.data(), s.size());
+        add(s.c_str(), 1);  // terminator keeps "ab"+"c" apart from "a"+"bc"
+    }
+    template <typename T>
+    void add_pod(const T& v) { add(&v, sizeof(T)); }
+};
+
+}  // namespace
+
+size_t DatasetManifest::file_rows(size_t i) const {
+    size_t rows = 0;
+    for (int64_t n : files[i].row_groups) rows += n;
+    return rows;
+}
+
+bool DatasetManifest::stats_compatible(const std::string& state, const std::string& action,
+                                       uint64_t schema) const {
+    return state_column == state && action_column == action && schema_hash == schema;
+}
+
+void DatasetManifest::save(const fs::path& path) const {
+    fs::path tmp_path = path;
+    tmp_path += ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot write " + tmp_path.string());
+        out.write(MAGIC, sizeof(MAGIC));
+        write_pod(out, VERSION);
+        write_pod(out, fingerprint);
+        write_string(out, state_column);
+        write_string(out, action_column);
+        write_pod(out, schema_hash);
+
+        write_pod<uint64_t>(out, files.size());
+        for (const auto& f : files) {
+            write_string(out, f.path);
+            write_pod(out, f.size);
+            write_pod(out, f.mtime);
+            write_vector(out, f.row_groups);
+        }
+        write_vector(out, episode_starts);
+        write_pod(out, state_dim);
+        write_pod(out, action_dim);
+        write_pod(out, fps);
+        state_stats.write(out);
+        action_stats.write(out);
+        if (!out) throw std::runtime_error("Failed writing " + tmp_path.string());
+    }
+    fs::rename(tmp_path, path);
+}
+
+std::optional<DatasetManifest> DatasetManifest::load(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    try {
+        char magic[sizeof(MAGIC)];
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            read_pod<uint32_t>(in) != VERSION)
+            return std::nullopt;
+
+        DatasetManifest m;
+        m.fingerprint = read_pod<uint64_t>(in);
+        m.state_column = read_string(in);
+        m.action_column = read_string(in);
+        m.schema_hash = read_pod<uint64_t>(in);
+        const auto num_files = read_pod<uint64_t>(in);
+        if (num_files > (uint64_t(1) << 24)) throw std::runtime_error("manifest corrupt");
+        for (uint64_t i = 0; i < num_files; ++i) {
+            ManifestFile f;
+            f.path = read_string(in);
+            f.size = read_pod<uint64_t>(in);
+            f.mtime = read_pod<int64_t>(in);
+            f.row_groups = read_vector<int64_t>(in);
+            m.files.push_back(std::move(f));
+        }
+        m.episode_starts = read_vector<size_t>(in);
+        m.state_dim = read_pod<int64_t>(in);
+        m.action_dim = read_pod<int64_t>(in);
+        m.fps = read_pod<double>(in);
+        m.state_stats = RunningStats::read(in);
+        m.action_stats = RunningStats::read(in);
+        return m;
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring manifest " << path << ": " << e.what() << "\n";
+        return std::nullopt;
+    }
+}
+
+std::vector<ManifestFile> stat_data_files(const fs::path& root, const std::vector<fs::path>& files) {
+    std::vector<ManifestFile> out;
+    for (const auto& path : files) {
+        ManifestFile f;
+        f.path = path.lexically_relative(root).string();
+        f.size = fs::file_size(path);
+        f.mtime = fs::last_write_time(path).time_since_epoch().count();
+        out.push_back(std::move(f));
+    }
+    return out;
+}
+
+uint64_t dataset_fingerprint(const std::vector<ManifestFile>& files, const std::string& schema,
+                             const std::string& state_column, const std::string& action_column) {
+    Fnv1a h;
+    h.add_pod<uint64_t>(files.size());
+    for (const auto& f : files) {
+        h.add(f.path);
+        h.add_pod(f.size);
+        h.add_pod(f.mtime);
+    }
+    h.add(schema);
+    h.add(state_column);
+    h.add(action_column);
+    return h.h;
+}
+
+std::string parquet_schema_string(const fs::path& file) {
+    auto reader = parquet::ParquetFileReader::OpenFile(file.string(), /*memory_map=*/false);
+    return reader->metadata()->schema()->ToString();
+}
+
+uint64_t schema_fingerprint(const std::string& schema) {
+    Fnv1a h;
+    h.add(schema);
+    return h.h;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "normalization.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct ManifestFile {
+    std::string path;                 // relative to the dataset root
+    uint64_t size = 0;
+    int64_t mtime = 0;                // file_time_type ticks
+    std::vector<int64_t> row_groups;  // rows per row group
+};
+
+// Everything the dataset constructor derives from a full pass over the
+// Parquet data, stored as <root>/manifest.lrm next to meta/. It is valid
+// while `fingerprint` matches the data files on disk (paths, sizes, mtimes,
+// schema of the first file, state/action columns); a stale manifest still
+// tells which files its normalization stats cover, as long as it was built
+// over the same columns and schema (stats_compatible).
+struct DatasetManifest {
+    static constexpr const char* FILE_NAME = "manifest.lrm";
+
+    uint64_t fingerprint = 0;
+    std::string state_column, action_column;  // the columns the stats were computed over
+    uint64_t schema_hash = 0;                 // schema_fingerprint of the first data file
+    std::vector<ManifestFile> files;  // data files in name order
+    std::vector<size_t> episode_starts;
+    int64_t state_dim = 0;
+    int64_t action_dim = 0;
+    double fps = 30.0;
+    RunningStats state_stats, action_stats;
+
+    size_t file_rows(size_t i) const;
+    // Whether state_stats/action_stats describe these columns of this schema,
+    // so they may be reused for unchanged files and merged with new ones
+    bool stats_compatible(const std::string& state, const std::string& action, uint64_t schema) const;
+
+    // Written to a temporary file and renamed into place, so concurrent
+    // readers never see a partial manifest.
+    void save(const fs::path& path) const;
+    // nullopt when missing, truncated or written by another version
+    static std::optional<DatasetManifest> load(const fs::path& path);
+};
+
+// Path, size and mtime of each data file; row_groups is left empty.
+std::vector<ManifestFile> stat_data_files(const fs::path& root, const std::vector<fs::path>& files);
+
+// FNV-1a over the stat'ed files, the Parquet schema of the first file and
+// the state/action column names.
+uint64_t dataset_fingerprint(const std::vector<ManifestFile>& files, const std::string& schema,
+                             const std::string& state_column, const std::string& action_column);
+
+// Schema of a Parquet file as text, read from its footer only
+std::string parquet_schema_string(const fs::path& file);
+
+// FNV-1a of a parquet_schema_string
+uint64_t schema_fingerprint(const std::string& schema);
@@ -0,0 +1,215 @@
+#include "normalization.h"
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+template <typename T>
+static void write_pod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+static T read_pod(std::istream& in) {
+    T v{};
+    if (!in.read(reinterpret_cast<char*>(&v), sizeof(T))) throw std::runtime_error("RunningStats: truncated data");
+    return v;
+}
+
+// --- QuantileSketch ---
+
+void QuantileSketch::add_sorted(const double* values, int64_t n) {
+    if (n <= 0) return;
+    if (static_cast<size_t>(n) <= capacity_) {
+        for (int64_t i = 0; i < n; ++i) items_.emplace_back(values[i], 1.0);
+    } else {
+        // evenly spaced order statistics, each standing in for n / capacity rows
+        double weight = double(n) / capacity_;
+        for (size_t i = 0; i < capacity_; ++i) {
+            int64_t idx = static_cast<int64_t>((i + 0.5) * weight);
+            items_.emplace_back(values[std::min(idx, n - 1)], weight);
+        }
+    }
+    compact();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    items_.insert(items_.end(), other.items_.begin(), other.items_.end());
+    compact();
+}
+
+void QuantileSketch::compact() {
+    while (items_.size() > capacity_) {
+        std::sort(items_.begin(), items_.end());
+        std::vector<std::pair<double, double>> out;
+        out.reserve(items_.size() / 2 + 1);
+        size_t i = 0;
+        for (; i + 1 < items_.size(); i += 2) {
+            const auto& a = items_[i];
+            const auto& b = items_[i + 1];
+            out.emplace_back(keep_upper_ ? b.first : a.first, a.second + b.second);
+        }
+        if (i < items_.size()) out.push_back(items_[i]);
+        keep_upper_ = !keep_upper_;
+        items_ = std::move(out);
+    }
+}
+
+double QuantileSketch::total_weight() const {
+    double w = 0.0;
+    for (const auto& it : items_) w += it.second;
+    return w;
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (items_.empty()) return 0.0;
+    auto sorted = items_;
+    std::sort(sorted.begin(), sorted.end());
+    double target = std::clamp(q, 0.0, 1.0) * total_weight();
+    double acc = 0.0;
+    for (const auto& [value, weight] : sorted) {
+        acc += weight;
+        if (acc >= target) return value;
+    }
+    return sorted.back().first;
+}
+
+void QuantileSketch::write(std::ostream& out) const {
+    write_pod<uint64_t>(out, capacity_);
+    write_pod<uint8_t>(out, keep_upper_);
+    write_pod<uint64_t>(out, items_.size());
+    for (const auto& [v, w] : items_) {
+        write_pod(out, v);
+        write_pod(out, w);
+    }
+}
+
+QuantileSketch QuantileSketch::read(std::istream& in) {
+    QuantileSketch s(read_pod<uint64_t>(in));
+    s.keep_upper_ = read_pod<uint8_t>(in);
+    const uint64_t n = read_pod<uint64_t>(in);
+    if (n > s.capacity_) throw std::runtime_error("QuantileSketch: inconsistent data");
+    for (uint64_t i = 0; i < n; ++i) {
+        double v = read_pod<double>(in);
+        s.items_.emplace_back(v, read_pod<double>(in));
+    }
+    return s;
+}
+
+// --- RunningStats ---
+
+RunningStats::RunningStats(int64_t dim)
+    : dim_(dim),
+      mean_(torch::zeros({dim}, torch::kFloat64)),
+      m2_(torch::zeros({dim}, torch::kFloat64)),
+      min_(torch::full({dim}, std::numeric_limits<double>::infinity(), torch::kFloat64)),
+      max_(torch::full({dim}, -std::numeric_limits<double>::infinity(), torch::kFloat64)),
+      sketches_(dim) {}
+
+void RunningStats::update(const torch::Tensor& x) {
+    if (x.dim() != 2 || x.size(1) != dim_)
+        throw std::invalid_argument("RunningStats::update expects [rows, " + std::to_string(dim_) + "]");
+    const int64_t n = x.size(0);
+    if (n == 0) return;
+
+    // exact stats of the block (two-pass within it), then Chan's combine
+    RunningStats block(dim_);
+    auto xd = x.to(torch::kFloat64);
+    block.count_ = n;
+    block.mean_ = xd.mean(0);
+    block.m2_ = (xd - block.mean_).pow(2).sum(0);
+    block.min_ = std::get<0>(xd.min(0));
+    block.max_ = std::get<0>(xd.max(0));
+
+    auto sorted = std::get<0>(xd.sort(0)).t().contiguous();  // [dim, rows], ascending
+    for (int64_t d = 0; d < dim_; ++d)
+        block.sketches_[d].add_sorted(sorted[d].data_ptr<double>(), n);
+
+    merge(block);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count_ == 0) return;
+    if (count_ == 0) {
+        *this = other;
+        return;
+    }
+    if (other.dim_ != dim_) throw std::invalid_argument("RunningStats::merge: dimension mismatch");
+
+    const double na = count_, nb = other.count_, n = na + nb;
+    auto delta = other.mean_ - mean_;
+    mean_ = mean_ + delta * (nb / n);
+    m2_ = m2_ + other.m2_ + delta.pow(2) * (na * nb / n);
+    min_ = torch::minimum(min_, other.min_);
+    max_ = torch::maximum(max_, other.max_);
+    for (int64_t d = 0; d < dim_; ++d) sketches_[d].merge(other.sketches_[d]);
+    count_ += other.count_;
+}
+
+torch::Tensor RunningStats::stddev() const {
+    if (count_ == 0) return torch::ones({dim_}, torch::kFloat32);
+    return (m2_ / count_).sqrt().clamp_min(1e-6).to(torch::kFloat32);
+}
+
+torch::Tensor RunningStats::quantile(double q) const {
+    std::vector<float> out(dim_);
+    for (int64_t d = 0; d < dim_; ++d) out[d] = sketches_[d].quantile(q);
+    return torch::tensor(out, torch::kFloat32);
+}
+
+static void write_tensor(std::ostream& out, const torch::Tensor& t) {
+    auto c = t.to(torch::kFloat64).contiguous();
+    out.write(reinterpret_cast<const char*>(c.data_ptr<double>()), c.numel() * sizeof(double));
+}
+
+static torch::Tensor read_tensor(std::istream& in, int64_t dim) {
+    auto t = torch::empty({dim}, torch::kFloat64);
+    if (!in.read(reinterpret_cast<char*>(t.data_ptr<double>()), dim * sizeof(double)))
+        throw std::runtime_error("RunningStats: truncated data");
+    return t;
+}
+
+void RunningStats::write(std::ostream& out) const {
+    write_pod(out, dim_);
+    write_pod(out, count_);
+    if (dim_ == 0) return;
+    for (const auto* t : {&mean_, &m2_, &min_, &max_}) write_tensor(out, *t);
+    for (const auto& s : sketches_) s.write(out);
+}
+
+RunningStats RunningStats::read(std::istream& in) {
+    const auto dim = read_pod<int64_t>(in);
+    if (dim < 0 || dim > (int64_t(1) << 20)) throw std::runtime_error("RunningStats: inconsistent data");
+    RunningStats s;
+    s.count_ = read_pod<int64_t>(in);
+    if (dim == 0) return s;
+    s.dim_ = dim;
+    s.mean_ = read_tensor(in, dim);
+    s.m2_ = read_tensor(in, dim);
+    s.min_ = read_tensor(in, dim);
+    s.max_ = read_tensor(in, dim);
+    for (int64_t d = 0; d < dim; ++d) s.sketches_.push_back(QuantileSketch::read(in));
+    return s;
+}
+
+Normalizer make_normalizer(const RunningStats& stats, NormMode mode, double eps) {
+    Normalizer n;
+    switch (mode) {
+        case NormMode::MeanStd:
+            n.shift = stats.mean();
+            n.scale = stats.stddev() + eps;
+            break;
+        case NormMode::MinMax:
+            n.shift = (stats.max() + stats.min()) / 2;
+            n.scale = (stats.max() - stats.min()) / 2 + eps;
+            break;
+        case NormMode::Quantile: {
+            auto lo = stats.quantile(0.01), hi = stats.quantile(0.99);
+            n.shift = (hi + lo) / 2;
+            n.scale = (hi - lo) / 2 + eps;
+            break;
+        }
+    }
+    return n;
+}
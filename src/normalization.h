@@ -0,0 +1,76 @@
+#pragma once
+#include <torch/torch.h>
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
+// Mergeable approximate quantiles for one dimension: weighted samples that
+// are pairwise compacted (sorted, adjacent pairs fused, alternating which
+// value survives) whenever they exceed the capacity. Rank error grows with
+// log(n / capacity) / capacity.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(size_t capacity = 1024) : capacity_(capacity) {}
+
+    void add_sorted(const double* values, int64_t n);  // ascending
+    void merge(const QuantileSketch& other);
+    double quantile(double q) const;
+    double total_weight() const;
+
+    void write(std::ostream& out) const;
+    static QuantileSketch read(std::istream& in);
+
+private:
+    size_t capacity_;
+    std::vector<std::pair<double, double>> items_;  // (value, weight)
+    bool keep_upper_ = false;
+
+    void compact();
+};
+
+// Per-dimension count/mean/M2 (Welford, combined across chunks with Chan et
+// al.'s pairwise update), min/max and quantile sketches. Each update() is a
+// handful of tensor reductions over a [rows, dim] block, and partial results
+// from different threads or files merge exactly.
+class RunningStats {
+public:
+    RunningStats() = default;
+    explicit RunningStats(int64_t dim);
+
+    void update(const torch::Tensor& x);  // [rows, dim]
+    void merge(const RunningStats& other);
+
+    int64_t dim() const { return dim_; }
+    int64_t count() const { return count_; }
+    torch::Tensor mean() const { return mean_.to(torch::kFloat32); }
+    torch::Tensor stddev() const;  // population std, clamped to >= 1e-6
+    torch::Tensor min() const { return min_.to(torch::kFloat32); }
+    torch::Tensor max() const { return max_.to(torch::kFloat32); }
+    torch::Tensor quantile(double q) const;  // [dim] float32
+
+    // little-endian binary, embedded in the dataset manifest
+    void write(std::ostream& out) const;
+    static RunningStats read(std::istream& in);
+
+private:
+    int64_t dim_ = 0;
+    int64_t count_ = 0;
+    torch::Tensor mean_, m2_, min_, max_;  // [dim] float64
+    std::vector<QuantileSketch> sketches_;
+};
+
+// Affine normalization x -> (x - shift) / scale:
+//  MeanStd  - shift = mean, scale = std
+//  MinMax   - [min, max] onto [-1, 1]
+//  Quantile - [q01, q99] onto [-1, 1], robust to outliers
+enum class NormMode { MeanStd, MinMax, Quantile };
+
+struct Normalizer {
+    torch::Tensor shift, scale;
+
+    torch::Tensor normalize(const torch::Tensor& x) const { return (x - shift) / scale; }
+    torch::Tensor denormalize(const torch::Tensor& x) const { return x * scale + shift; }
+};
+
+Normalizer make_normalizer(const RunningStats& stats, NormMode mode, double eps = 1e-5);
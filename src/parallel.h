@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline size_t default_num_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run fn(i) for every i in [0, n) on up to num_threads threads, handing out
+// indices through an atomic counter. The first exception thrown by fn is
+// rethrown on the calling thread once all threads have stopped.
+template <typename Fn>
+void parallel_for(size_t n, Fn&& fn, size_t num_threads = default_num_threads()) {
+    num_threads = std::min(num_threads, n);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < n;) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next = n;  // stop handing out work
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) threads.emplace_back(work);
+    work();
+    for (auto& t : threads) t.join();
+    if (error) std::rethrow_exception(error);
+}
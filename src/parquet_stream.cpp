@@ -0,0 +1,237 @@
+#include "parquet_stream.h"
+#include <arrow/io/api.h>
+#include <arrow/util/byte_size.h>
+#include <parquet/exception.h>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <set>
+
+ParquetStream::ParquetStream(std::vector<fs::path> files, ParquetStreamOptions options,
+                             const std::vector<std::vector<int64_t>>& layout)
+    : options_(std::move(options)) {
+    const bool known_layout = layout.size() == files.size();
+    for (const auto& path : files) {
+        auto file = std::make_unique<File>();
+        file->path = path;
+        std::vector<int64_t> rows;
+        if (known_layout) {
+            rows = layout[files_.size()];
+        } else {
+            // --- Row layout straight from the footer ---
+            open(*file);
+            auto meta = file->reader->parquet_reader()->metadata();
+            for (int rg = 0; rg < meta->num_row_groups(); ++rg) rows.push_back(meta->RowGroup(rg)->num_rows());
+        }
+        files_.push_back(std::move(file));
+        add_groups(files_.size() - 1, rows);
+    }
+    readahead_thread_ = std::thread(&ParquetStream::readahead_loop, this);
+    std::cout << "Streaming " << files_.size() << " files, " << groups_.size()
+              << " row groups, " << num_rows() << " frames"
+              << (known_layout ? " (layout from manifest)" : "") << "\n";
+}
+
+void ParquetStream::open(File& file) {
+    if (file.reader) return;
+    auto maybe_infile = arrow::io::ReadableFile::Open(file.path.string());
+    if (!maybe_infile.ok()) {
+        throw std::runtime_error("Failed to open: " + file.path.string() +
+                                 " - " + maybe_infile.status().ToString());
+    }
+    auto maybe_reader = parquet::arrow::OpenFile(*maybe_infile, arrow::default_memory_pool());
+    if (!maybe_reader.ok()) {
+        throw std::runtime_error("Parquet open failed: " + maybe_reader.status().ToString());
+    }
+    file.reader = std::move(*maybe_reader);
+    PARQUET_THROW_NOT_OK(file.reader->GetSchema(&file.schema));
+}
+
+void ParquetStream::add_groups(size_t file, const std::vector<int64_t>& rows) {
+    for (size_t rg = 0; rg < rows.size(); ++rg) {
+        groups_.push_back({file, static_cast<int>(rg)});
+        group_offsets_.push_back(group_offsets_.back() + rows[rg]);
+        files_[file]->rows += rows[rg];
+    }
+}
+
+ParquetStream::~ParquetStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    readahead_cv_.notify_all();
+    readahead_thread_.join();
+}
+
+std::vector<int64_t> ParquetStream::row_group_rows(size_t file) const {
+    std::vector<int64_t> rows;
+    for (size_t g = 0; g < groups_.size(); ++g)
+        if (groups_[g].file == file) rows.push_back(group_offsets_[g + 1] - group_offsets_[g]);
+    return rows;
+}
+
+std::shared_ptr<arrow::Schema> ParquetStream::schema() const {
+    if (files_.empty()) return nullptr;
+    File& file = *files_.front();
+    std::lock_guard<std::mutex> lock(file.mutex);
+    open(file);
+    return file.schema;
+}
+
+std::string ParquetStream::file_metadata(size_t file, const std::string& key) const {
+    File& f = *files_[file];
+    std::shared_ptr<const arrow::KeyValueMetadata> meta;
+    {
+        std::lock_guard<std::mutex> lock(f.mutex);
+        open(f);
+        meta = f.schema->metadata();
+    }
+    if (!meta || meta->FindKey(key) == -1) return "";
+    return meta->Get(key).ValueOr("");
+}
+
+size_t ParquetStream::group_of(size_t row) const {
+    if (row >= num_rows())
+        throw std::out_of_range("Frame index " + std::to_string(row) + " out of range");
+    auto it = std::upper_bound(group_offsets_.begin(), group_offsets_.end(), row);
+    return std::distance(group_offsets_.begin(), it) - 1;
+}
+
+// Parquet readers take leaf column indices; a top-level field such as a
+// fixed-size list maps to the leaves below it.
+std::vector<int> ParquetStream::leaf_indices(const File& file,
+                                             const std::vector<std::string>& columns) const {
+    const auto* descr = file.reader->parquet_reader()->metadata()->schema();
+    std::vector<int> leaves;
+    for (int i = 0; i < descr->num_columns(); ++i) {
+        const auto& root = descr->GetColumnRoot(i)->name();
+        if (std::find(columns.begin(), columns.end(), root) != columns.end()) leaves.push_back(i);
+    }
+    return leaves;
+}
+
+std::shared_ptr<arrow::Table> ParquetStream::read_group(size_t g, const std::vector<std::string>& columns) {
+    File& file = *files_[groups_[g].file];
+    std::shared_ptr<arrow::Table> table;
+    std::lock_guard<std::mutex> lock(file.mutex);
+    open(file);
+    PARQUET_THROW_NOT_OK(file.reader->ReadRowGroup(groups_[g].index, leaf_indices(file, columns), &table));
+    return table;
+}
+
+std::shared_ptr<arrow::Table> ParquetStream::load(size_t g, bool readahead) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        auto it = cache_.find(g);
+        if (it == cache_.end()) break;
+        if (!it->second.loading) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+            if (!readahead) ++stats_.hits;
+            return it->second.table;
+        }
+        if (readahead) return nullptr;  // someone is already on it
+        cv_.wait(lock);
+    }
+    cache_[g].loading = true;
+    lock.unlock();
+
+    std::shared_ptr<arrow::Table> table;
+    try {
+        table = read_group(g, options_.columns);
+    } catch (...) {
+        lock.lock();
+        cache_.erase(g);
+        cv_.notify_all();
+        throw;
+    }
+    size_t bytes = arrow::util::TotalBufferSize(*table);
+
+    lock.lock();
+    auto& slot = cache_[g];
+    slot.table = table;
+    slot.bytes = bytes;
+    slot.loading = false;
+    lru_.push_front(g);
+    slot.lru_pos = lru_.begin();
+    stats_.cached_bytes += bytes;
+    ++stats_.loads;
+    if (readahead) ++stats_.readahead_loads;
+    evict(g);
+    cv_.notify_all();
+    return table;
+}
+
+void ParquetStream::evict(size_t keep) {
+    while (stats_.cached_bytes > options_.memory_budget && !lru_.empty()) {
+        size_t victim = lru_.back();
+        if (victim == keep) break;  // a single group larger than the budget stays
+        lru_.pop_back();
+        stats_.cached_bytes -= cache_[victim].bytes;
+        cache_.erase(victim);
+        ++stats_.evictions;
+    }
+}
+
+std::shared_ptr<arrow::Table> ParquetStream::row_group(size_t row, int64_t& local_row) {
+    size_t g = group_of(row);
+    local_row = row - group_offsets_[g];
+    return load(g, false);
+}
+
+void ParquetStream::scan(const std::vector<std::string>& columns,
+                         const std::function<void(const arrow::Table&)>& fn) {
+    for (size_t g = 0; g < groups_.size(); ++g) fn(*read_group(g, columns));
+}
+
+void ParquetStream::scan_file(size_t file, const std::vector<std::string>& columns,
+                              const std::function<void(const arrow::Table&)>& fn) {
+    for (size_t g = 0; g < groups_.size(); ++g)
+        if (groups_[g].file == file) fn(*read_group(g, columns));
+}
+
+// Queue the row groups behind the upcoming rows, in access order, skipping
+// ones already cached; older hints are dropped when the queue is full.
+void ParquetStream::hint(const std::vector<size_t>& upcoming_rows) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::set<size_t> queued(readahead_.begin(), readahead_.end());
+        for (size_t row : upcoming_rows) {
+            if (row >= num_rows()) continue;
+            size_t g = group_of(row);
+            if (cache_.count(g) || !queued.insert(g).second) continue;
+            readahead_.push_back(g);
+        }
+        while (readahead_.size() > options_.max_readahead) readahead_.pop_front();
+    }
+    readahead_cv_.notify_one();
+}
+
+void ParquetStream::readahead_loop() {
+    for (;;) {
+        size_t g;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            readahead_cv_.wait(lock, [&] { return stop_ || !readahead_.empty(); });
+            if (stop_) return;
+            g = readahead_.front();
+            readahead_.pop_front();
+        }
+        try {
+            load(g, true);
+        } catch (const std::exception& e) {
+            std::cerr << "Read-ahead of row group " << g << " failed: " << e.what() << "\n";
+        }
+    }
+}
+
+void ParquetStream::set_memory_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_.memory_budget = bytes;
+    evict(SIZE_MAX);
+}
+
+ParquetStreamStats ParquetStream::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <arrow/api.h>
+#include <parquet/arrow/reader.h>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct ParquetStreamOptions {
+    std::vector<std::string> columns;        // projection; names missing from a file are skipped
+    size_t memory_budget = size_t(1) << 30;  // bytes of decoded row groups kept cached
+    size_t max_readahead = 16;               // row groups queued for the read-ahead thread
+};
+
+struct ParquetStreamStats {
+    uint64_t loads = 0;           // row groups decoded (demand + read-ahead)
+    uint64_t readahead_loads = 0;
+    uint64_t hits = 0;
+    uint64_t evictions = 0;
+    size_t cached_bytes = 0;
+};
+
+// Row-group granular access to a set of Parquet files. Construction reads
+// only the footers, so num_rows() and the row layout come from metadata.
+// With a known layout (row-group sizes per file, e.g. from a DatasetManifest)
+// not even the footers are read until a file is first accessed.
+// Row groups are decoded on first access with just the projected columns,
+// kept in an LRU under memory_budget, and can be requested ahead of time
+// with hint() so a background thread decodes them before a reader needs them.
+class ParquetStream {
+public:
+    ParquetStream(std::vector<fs::path> files, ParquetStreamOptions options,
+                  const std::vector<std::vector<int64_t>>& layout = {});
+    ~ParquetStream();
+    ParquetStream(const ParquetStream&) = delete;
+    ParquetStream& operator=(const ParquetStream&) = delete;
+
+    size_t num_rows() const { return group_offsets_.back(); }
+    size_t num_files() const { return files_.size(); }
+    size_t file_rows(size_t file) const { return files_[file]->rows; }
+    size_t num_row_groups() const { return groups_.size(); }
+    std::vector<int64_t> row_group_rows(size_t file) const;
+    std::shared_ptr<arrow::Schema> schema() const;  // full schema of the first file
+    std::string file_metadata(size_t file, const std::string& key) const;
+
+    // Cached row group holding global `row`; local_row is set to its offset.
+    // The returned table stays valid after eviction.
+    std::shared_ptr<arrow::Table> row_group(size_t row, int64_t& local_row);
+
+    // Decode every row group once with a narrower projection, bypassing the
+    // cache (used for statistics and index scans).
+    void scan(const std::vector<std::string>& columns,
+              const std::function<void(const arrow::Table&)>& fn);
+    void scan_file(size_t file, const std::vector<std::string>& columns,
+                   const std::function<void(const arrow::Table&)>& fn);
+
+    void hint(const std::vector<size_t>& upcoming_rows);
+    void set_memory_budget(size_t bytes);
+    ParquetStreamStats stats() const;
+
+private:
+    struct File {
+        fs::path path;
+        std::unique_ptr<parquet::arrow::FileReader> reader;  // null until opened
+        std::shared_ptr<arrow::Schema> schema;
+        size_t rows = 0;
+        std::mutex mutex;  // guards reader; FileReader is not safe for concurrent reads
+    };
+    struct Group {
+        size_t file;
+        int index;  // row group within the file
+    };
+    struct Slot {
+        std::shared_ptr<arrow::Table> table;
+        size_t bytes = 0;
+        bool loading = false;
+        std::list<size_t>::iterator lru_pos;
+    };
+
+    ParquetStreamOptions options_;
+    std::vector<std::unique_ptr<File>> files_;
+    std::vector<Group> groups_;
+    std::vector<size_t> group_offsets_{0};  // prefix sums of row-group sizes
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<size_t, Slot> cache_;
+    std::list<size_t> lru_;  // loaded groups, front = most recent
+    ParquetStreamStats stats_;
+
+    std::deque<size_t> readahead_;
+    std::condition_variable readahead_cv_;
+    std::thread readahead_thread_;
+    bool stop_ = false;
+
+    static void open(File& file);  // expects file.mutex held
+    void add_groups(size_t file, const std::vector<int64_t>& rows);
+    size_t group_of(size_t row) const;
+    std::vector<int> leaf_indices(const File& file, const std::vector<std::string>& columns) const;
+    std::shared_ptr<arrow::Table> read_group(size_t g, const std::vector<std::string>& columns);
+    std::shared_ptr<arrow::Table> load(size_t g, bool readahead);
+    void evict(size_t keep);  // expects mutex_ held
+    void readahead_loop();
+};
@@ -0,0 +1,247 @@
+#include "policy_export.h"
+#include <torch/csrc/jit/frontend/resolver.h>
+#include <torch/csrc/jit/frontend/sugared_value.h>
+#include <ATen/core/dispatch/Dispatcher.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+const char* precision_name(PolicyPrecision precision) {
+    switch (precision) {
+        case PolicyPrecision::FP32: return "fp32";
+        case PolicyPrecision::INT8: return "int8";
+        case PolicyPrecision::BF16: return "bf16";
+    }
+    return "?";
+}
+
+PolicyPrecision parse_precision(const std::string& name) {
+    if (name == "fp32") return PolicyPrecision::FP32;
+    if (name == "int8") return PolicyPrecision::INT8;
+    if (name == "bf16") return PolicyPrecision::BF16;
+    throw std::invalid_argument("Unknown precision " + name + " (fp32, int8, bf16)");
+}
+
+namespace {
+
+// `quantized.<op>` in generated source -> the quantized:: operators; the
+// default resolver only knows `torch`
+struct QuantizedResolver : torch::jit::Resolver {
+    std::shared_ptr<torch::jit::SugaredValue> resolveValue(const std::string& name, torch::jit::GraphFunction& m,
+                                                           const torch::jit::SourceRange& loc) override {
+        if (name == "quantized") return std::make_shared<torch::jit::BuiltinModule>("quantized");
+        return torch::jit::nativeResolver()->resolveValue(name, m, loc);
+    }
+    c10::TypePtr resolveType(const std::string& name, const torch::jit::SourceRange& loc) override {
+        return torch::jit::nativeResolver()->resolveType(name, loc);
+    }
+};
+
+// INT8 weights, one scale per output channel, packed for fbgemm's dynamic
+// linear (activations are quantized on the fly per call)
+c10::IValue pack_int8_linear(const torch::Tensor& weight, const torch::Tensor& bias) {
+    auto w = weight.detach().to(torch::kFloat32).contiguous();
+    auto scales = (w.abs().amax(1) / 127.0).clamp_min(1e-8).to(torch::kFloat64);
+    auto zero_points = torch::zeros({w.size(0)}, torch::kInt64);
+    auto qweight = torch::quantize_per_channel(w, scales, zero_points, 0, torch::kQInt8);
+
+    static const auto prepack =
+        c10::Dispatcher::singleton().findSchemaOrThrow("quantized::linear_prepack", "");
+    torch::jit::Stack stack{qweight, c10::optional<torch::Tensor>(bias.detach().to(torch::kFloat32))};
+    prepack.callBoxed(&stack);
+    return stack.at(0);
+}
+
+// Multi-head attention core on projected, seq-first q/k/v (q pre-scaled),
+// as torch::nn::MultiheadAttention computes it; mask [B * heads, 1, S] is
+// added to the scores (-inf on padded keys)
+const char* ATTENTION_SRC = R"JIT(
+def attention(self, qq: Tensor, kk: Tensor, vv: Tensor, heads: int, mask: Optional[Tensor]) -> Tensor:
+    L = qq.size(0)
+    S = kk.size(0)
+    B = qq.size(1)
+    E = qq.size(2)
+    hd = E // heads
+    qq = qq.reshape([L, B * heads, hd]).transpose(0, 1)
+    kk = kk.reshape([S, B * heads, hd]).transpose(0, 1)
+    vv = vv.reshape([S, B * heads, hd]).transpose(0, 1)
+    scores = torch.bmm(qq, kk.transpose(1, 2))
+    if mask is not None:
+        scores = scores + mask
+    attn = torch.softmax(scores, -1)
+    return torch.bmm(attn, vv).transpose(0, 1).reshape([L, B, E])
+)JIT";
+
+// Collects the attributes and source of the script module
+class ScriptBuilder {
+public:
+    ScriptBuilder(ACTPolicy& policy, PolicyPrecision precision)
+        : params_(policy->named_parameters()), precision_(precision), m_("ACTPolicyScript") {}
+
+    torch::Tensor param(const std::string& name) { return params_[name].detach(); }
+
+    // weights the precision leaves as plain tensors (conv, embeddings, norms)
+    std::string tensor(const std::string& name, const torch::Tensor& t) {
+        auto attr = attr_name(name);
+        m_.register_parameter(attr, cast(t).clone(), false);
+        return "self." + attr;
+    }
+    std::string tensor(const std::string& name) { return tensor(name, param(name)); }
+
+    // x @ weight^T + bias, quantized in INT8 mode
+    std::string linear(const std::string& x, const std::string& name, const torch::Tensor& weight,
+                       const torch::Tensor& bias) {
+        auto attr = attr_name(name);
+        if (precision_ == PolicyPrecision::INT8) {
+            auto packed = pack_int8_linear(weight, bias);
+            m_.register_attribute(attr + "_packed", packed.type(), packed);
+            return "quantized.linear_dynamic(" + x + ", self." + attr + "_packed)";
+        }
+        m_.register_parameter(attr + "_weight", cast(weight).clone(), false);
+        m_.register_parameter(attr + "_bias", cast(bias).clone(), false);
+        return "torch.linear(" + x + ", self." + attr + "_weight, self." + attr + "_bias)";
+    }
+    std::string linear(const std::string& x, const std::string& name) {
+        return linear(x, name, param(name + ".weight"), param(name + ".bias"));
+    }
+
+    void buffer(const std::string& name, const torch::Tensor& t) {  // stays FP32
+        m_.register_buffer(name, t.to(torch::kFloat32).clone());
+    }
+
+    torch::jit::Module finish(const std::string& forward_src) {
+        auto resolver = std::make_shared<QuantizedResolver>();
+        m_.define(ATTENTION_SRC, resolver);
+        m_.define(forward_src, resolver);
+        m_.eval();
+        return m_;
+    }
+
+private:
+    torch::OrderedDict<std::string, torch::Tensor> params_;
+    PolicyPrecision precision_;
+    torch::jit::Module m_;
+
+    static std::string attr_name(std::string name) {
+        std::replace(name.begin(), name.end(), '.', '_');
+        return name;
+    }
+    torch::Tensor cast(const torch::Tensor& t) const {
+        return precision_ == PolicyPrecision::BF16 ? t.detach().to(torch::kBFloat16) : t.detach();
+    }
+};
+
+}  // namespace
+
+torch::jit::Module script_policy(ACTPolicy& policy, const ACTConfig& config, PolicyPrecision precision) {
+    ScriptBuilder b(policy, precision);
+    b.buffer("state_mean", config.state_mean);
+    b.buffer("state_scale", config.state_std + 1e-5);
+    b.buffer("action_mean", config.action_mean);
+    b.buffer("action_scale", config.action_std + 1e-5);
+
+    const int H = policy->hidden_dim;
+    const int heads = policy->encoder->heads;
+    const int64_t enc_layers = policy->encoder->layers->size();
+    const int64_t dec_layers = policy->decoder->layers->size();
+    std::ostringstream scale;
+    scale.precision(17);
+    scale << 1.0 / std::sqrt(double(H / heads));
+    const std::string Hs = std::to_string(H);
+
+    auto norm = [&](const std::string& prefix, const std::string& expr) {
+        return "torch.layer_norm(" + expr + ", [" + Hs + "], " + b.tensor(prefix + ".weight") + ", " +
+               b.tensor(prefix + ".bias") + ", 1e-05)";
+    };
+    // in_proj is split so each projection is its own (possibly quantized) linear
+    auto attention = [&](const std::string& prefix, const std::string& q, const std::string& kv,
+                         const std::string& mask) {
+        auto w = b.param(prefix + ".in_proj_weight").chunk(3);
+        auto bias = b.param(prefix + ".in_proj_bias").chunk(3);
+        auto core = "self.attention(" + b.linear(q, prefix + ".q_proj", w[0], bias[0]) + " * " + scale.str() +
+                    ", " + b.linear(kv, prefix + ".k_proj", w[1], bias[1]) + ", " +
+                    b.linear(kv, prefix + ".v_proj", w[2], bias[2]) + ", " + std::to_string(heads) + ", " +
+                    mask + ")";
+        return b.linear(core, prefix + ".out_proj");
+    };
+    auto feed_forward = [&](const std::string& p, const std::string& x) {
+        return b.linear("torch.relu(" + b.linear(x, p + ".linear1") + ")", p + ".linear2");
+    };
+
+    // --- forward, with the layer stacks unrolled; mirrors ACTPolicyImpl::forward_tokens ---
+    std::ostringstream src;
+    auto conv = [&](const std::string& name, int stride) {
+        return "torch.relu(torch.conv2d(x, " + b.tensor(name + ".weight") + ", " + b.tensor(name + ".bias") +
+               ", [" + std::to_string(stride) + ", " + std::to_string(stride) + "]))";
+    };
+    const std::string conv1_w = b.tensor("conv1.weight");
+    src << "def forward(self, images: Tensor, state: Tensor, image_mask: Optional[Tensor] = None) -> Tensor:\n"
+        << "    B = state.size(0)\n"
+        << "    T = images.size(1)\n"
+        << "    x = torch.relu(torch.conv2d(images.flatten(0, 1).div(255.0).type_as(" << conv1_w << "), "
+        << conv1_w << ", " << b.tensor("conv1.bias") << ", [4, 4]))\n"
+        << "    x = " << conv("conv2", 2) << "\n"
+        << "    x = " << conv("conv3", 2) << "\n"
+        << "    x = torch.adaptive_avg_pool2d(x, [7, 7])\n"
+        << "    tokens = x.flatten(2).transpose(1, 2).reshape([B, T, 49, " << Hs << "])\n"
+        << "    time = " << b.tensor("time_embed") << "[" << policy->max_history << " - T:].reshape([1, T, 1, "
+        << Hs << "])\n"
+        << "    tokens = (tokens + " << b.tensor("pos_embed") << ".reshape([1, 1, 49, " << Hs << "]) + time)"
+        << ".reshape([B, T * 49, " << Hs << "])\n"
+        << "    s = ((state - self.state_mean) / self.state_scale).type_as(tokens)\n"
+        << "    x = torch.cat([tokens, " << b.linear("s", "state_proj") << ".unsqueeze(1)], 1).transpose(0, 1)\n"
+        // padded history frames are hidden from the encoder and the decoder's cross-attention
+        << "    mask: Optional[Tensor] = None\n"
+        << "    if image_mask is not None:\n"
+        << "        keep = torch.cat([image_mask.to(torch.bool).repeat_interleave(49, 1), "
+        << "torch.ones([B, 1], dtype=torch.bool, device=image_mask.device)], 1)\n"
+        << "        mask = torch.zeros_like(keep, dtype=x.dtype).masked_fill(~keep, float('-inf'))"
+        << ".unsqueeze(1).repeat_interleave(" << heads << ", 0)\n";
+
+    for (int64_t l = 0; l < enc_layers; ++l) {
+        std::string p = "encoder.layers." + std::to_string(l);
+        src << "    x = " << norm(p + ".norm1", "x + " + attention(p + ".self_attn", "x", "x", "mask")) << "\n"
+            << "    x = " << norm(p + ".norm2", "x + " + feed_forward(p, "x")) << "\n";
+    }
+    src << "    q = " << b.tensor("query_embed") << ".unsqueeze(1).expand([" << policy->chunk_size << ", B, " << Hs
+        << "])\n";
+    for (int64_t l = 0; l < dec_layers; ++l) {
+        std::string p = "decoder.layers." + std::to_string(l);
+        src << "    q = " << norm(p + ".norm1", "q + " + attention(p + ".self_attn", "q", "q", "None")) << "\n"
+            << "    q = " << norm(p + ".norm2", "q + " + attention(p + ".multihead_attn", "q", "x", "mask")) << "\n"
+            << "    q = " << norm(p + ".norm3", "q + " + feed_forward(p, "q")) << "\n";
+    }
+    src << "    out = " << b.linear("q", "head") << ".transpose(0, 1).type_as(self.action_mean)\n"
+        << "    return out * self.action_scale + self.action_mean\n";
+
+    return b.finish(src.str());
+}
+
+torch::jit::Module freeze_policy(ACTPolicy& policy, const ACTConfig& config, PolicyPrecision precision) {
+    return torch::jit::freeze(script_policy(policy, config, precision));
+}
+
+torch::jit::Module load_optimized_policy(const fs::path& path) {
+    auto m = torch::jit::load(path.string());
+    m.eval();
+    return torch::jit::optimize_for_inference(m);
+}
+
+BatchedPolicy load_batched_policy(const ACTConfig& config, const fs::path& checkpoint, const fs::path& script) {
+    if (!script.empty()) {
+        auto scripted = std::make_shared<torch::jit::Module>(load_optimized_policy(script));
+        return [scripted](const torch::Tensor& images, const torch::Tensor& state) {
+            return scripted->forward({images, state}).toTensor();
+        };
+    }
+    ACTPolicy policy = config.make_policy();
+    torch::load(policy, checkpoint.string());
+    policy->eval();
+    auto state_scale = config.state_std + 1e-5;
+    auto action_scale = config.action_std + 1e-5;
+    return [=](const torch::Tensor& images, const torch::Tensor& state) mutable {
+        auto norm_state = (state - config.state_mean) / state_scale;
+        return policy->forward(images, norm_state).mul_(action_scale).add_(config.action_mean);
+    };
+}
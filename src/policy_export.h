@@ -0,0 +1,45 @@
+#pragma once
+#include "act_policy.h"
+#include <torch/script.h>
+#include <functional>
+
+// Numeric variants of the exported graph:
+//  FP32 - as trained
+//  INT8 - every linear (state_proj, attention projections, feed-forward,
+//         head) dynamically quantized: per-channel INT8 weights, activations
+//         quantized per call; convs, norms and embeddings stay FP32
+//  BF16 - all weights and activations in bfloat16 (fast with AVX512-BF16 /
+//         AMX, emulated elsewhere); normalization in and out stays FP32
+enum class PolicyPrecision { FP32, INT8, BF16 };
+const char* precision_name(PolicyPrecision precision);
+PolicyPrecision parse_precision(const std::string& name);
+
+// TorchScript version of ACTPolicy::forward for inference, with state
+// normalization and action denormalization folded into the graph:
+//   forward(images [B, T, 3, H, W] uint8, state [B, state_dim] raw,
+//           image_mask [B, T] bool = None)
+//       -> actions [B, chunk_size, action_dim] in dataset units
+// Eval-mode semantics (no dropout). Frames false in image_mask are padding
+// and hidden from attention as in training; without it all are real.
+// The script is generated from the policy's shapes and its parameters are
+// copied in, so the C++ module itself never needs to be traced.
+torch::jit::Module script_policy(ACTPolicy& policy, const ACTConfig& config,
+                                 PolicyPrecision precision = PolicyPrecision::FP32);
+
+// script_policy + torch::jit::freeze: weights and norm stats become
+// constants. This is the form that is saved to disk.
+torch::jit::Module freeze_policy(ACTPolicy& policy, const ACTConfig& config,
+                                 PolicyPrecision precision = PolicyPrecision::FP32);
+
+// Load a frozen policy and run optimize_for_inference on it (conv/linear +
+// ReLU fusion, constant folding, prepacked weights). The optimized form is
+// not serialized, so it is rebuilt on every load.
+torch::jit::Module load_optimized_policy(const fs::path& path);
+
+// raw images [B, T, 3, H, W] uint8 + raw state [B, state_dim] -> [B, k, action_dim] in dataset units
+using BatchedPolicy = std::function<torch::Tensor(const torch::Tensor& images, const torch::Tensor& state)>;
+
+// The eager checkpoint with normalization wrapped around it, or, when
+// script is given, the optimized frozen export (normalization inside).
+// Call under InferenceMode.
+BatchedPolicy load_batched_policy(const ACTConfig& config, const fs::path& checkpoint, const fs::path& script = {});
@@ -0,0 +1,324 @@
+#include "policy_server.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// --- Socket helpers ---
+
+static bool read_all(int fd, void* buf, size_t n) {
+    auto* p = static_cast<char*>(buf);
+    while (n > 0) {
+        ssize_t got = ::recv(fd, p, n, 0);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) continue;
+            return false;
+        }
+        p += got;
+        n -= got;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void* buf, size_t n) {
+    auto* p = static_cast<const char*>(buf);
+    while (n > 0) {
+        ssize_t sent = ::send(fd, p, n, MSG_NOSIGNAL);  // a vanished client must not SIGPIPE us
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) continue;
+            return false;
+        }
+        p += sent;
+        n -= sent;
+    }
+    return true;
+}
+
+static sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw std::invalid_argument("Socket path too long: " + path);
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+// --- PolicyServer ---
+
+PolicyServer::PolicyServer(BatchedPolicy policy, const ACTConfig& config, PolicyServerOptions options)
+    : policy_(std::move(policy)), config_(config), options_(options) {
+    options_.max_batch = std::max<size_t>(options_.max_batch, 1);
+    batch_sizes_.assign(options_.max_batch + 1, 0);
+}
+
+PolicyServer::~PolicyServer() { stop(); }
+
+void PolicyServer::start() {
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::runtime_error("socket() failed");
+    auto addr = unix_address(options_.socket_path);
+    ::unlink(options_.socket_path.c_str());  // stale socket from a previous run
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 64) < 0)
+        throw std::runtime_error("Cannot listen on " + options_.socket_path + ": " + std::strerror(errno));
+
+    accept_thread_ = std::thread(&PolicyServer::accept_loop, this);
+    batch_thread_ = std::thread(&PolicyServer::batch_loop, this);
+    std::cout << "Policy server on " << options_.socket_path << " (max_batch=" << options_.max_batch
+              << ", window=" << options_.window_us << "us)\n";
+}
+
+void PolicyServer::stop() {
+    if (stop_.exchange(true)) return;
+    if (listen_fd_ >= 0) ::shutdown(listen_fd_, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex_);
+        for (auto& c : connections_) ::shutdown(c->fd, SHUT_RDWR);  // unblocks readers
+    }
+    queue_cv_.notify_all();
+    if (accept_thread_.joinable()) accept_thread_.join();
+    if (batch_thread_.joinable()) batch_thread_.join();
+    for (auto& r : readers_) r.thread.join();  // accept thread is gone, readers_ no longer grows; each closes its fd
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(options_.socket_path.c_str());
+    }
+}
+
+void PolicyServer::accept_loop() {
+    while (!stop_) {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;  // listening socket shut down
+        }
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        std::lock_guard<std::mutex> lock(conn_mutex_);
+        if (stop_) {
+            ::close(fd);
+            return;
+        }
+        // join readers whose client has left, so a long-running server
+        // doesn't keep one finished thread per past connection
+        for (auto it = readers_.begin(); it != readers_.end();) {
+            if (!it->conn->done) {
+                ++it;
+                continue;
+            }
+            it->thread.join();  // done is set last, under conn_mutex_: the reader is returning
+            it = readers_.erase(it);
+        }
+        connections_.push_back(conn);
+        readers_.push_back({std::thread(&PolicyServer::read_loop, this, conn), conn});
+    }
+}
+
+void PolicyServer::read_loop(std::shared_ptr<Connection> conn) {
+    receive(conn);
+    // client left or misbehaved; answers still queued for it are dropped in respond()
+    std::lock_guard<std::mutex> lock(conn_mutex_);
+    std::lock_guard<std::mutex> write_lock(conn->write_mutex);
+    ::close(conn->fd);
+    conn->fd = -1;
+    connections_.erase(std::find(connections_.begin(), connections_.end(), conn));
+    conn->done = true;
+}
+
+void PolicyServer::receive(const std::shared_ptr<Connection>& conn) {
+    while (!stop_) {
+        Request r;
+        if (!read_all(conn->fd, &r.header, sizeof(r.header))) return;
+        const auto& h = r.header;
+        const bool valid = h.magic == POLICY_REQUEST_MAGIC && h.state_dim == uint32_t(config_.state_dim) &&
+                           h.history >= 1 && h.history <= uint32_t(config_.max_history) && h.height > 0 &&
+                           h.width > 0 && uint64_t(h.history) * h.height * h.width <= (uint64_t(1) << 28);
+        if (!valid) {
+            // the payload size can't be trusted either: answer and drop the connection
+            PolicyResponseHeader resp;
+            resp.id = h.id;
+            resp.status = PolicyStatus::BadRequest;
+            respond(*conn, resp, nullptr);
+            return;
+        }
+        r.images = torch::empty({h.history, 3, h.height, h.width}, torch::kUInt8);
+        r.state = torch::empty({h.state_dim}, torch::kFloat32);
+        if (!read_all(conn->fd, r.images.data_ptr(), r.images.nbytes()) ||
+            !read_all(conn->fd, r.state.data_ptr(), r.state.nbytes()))
+            return;
+        r.arrived = Clock::now();
+        r.conn = conn;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back(std::move(r));
+        }
+        queue_cv_.notify_one();
+    }
+}
+
+void PolicyServer::batch_loop() {
+    torch::InferenceMode inference_mode;
+    const auto window = std::chrono::microseconds(options_.window_us);
+    std::vector<Request> batch;
+    while (true) {
+        size_t depth;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            // hold the batch open until it is full or the oldest request has waited window_us
+            const auto deadline = queue_.front().arrived + window;
+            queue_cv_.wait_until(lock, deadline, [&] { return stop_ || queue_.size() >= options_.max_batch; });
+            if (stop_) return;
+
+            depth = queue_.size();
+            const auto& front = queue_.front().header;
+            for (auto it = queue_.begin(); it != queue_.end() && batch.size() < options_.max_batch;) {
+                const auto& h = it->header;
+                if (h.history == front.history && h.height == front.height && h.width == front.width) {
+                    batch.push_back(std::move(*it));
+                    it = queue_.erase(it);
+                } else {
+                    ++it;  // different shape: waits for its own batch
+                }
+            }
+        }
+        run_batch(batch);
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            ++batches_;
+            ++batch_sizes_[batch.size()];
+            depth_sum_ += depth;
+            depth_max_ = std::max<uint64_t>(depth_max_, depth);
+        }
+        batch.clear();
+    }
+}
+
+void PolicyServer::run_batch(std::vector<Request>& batch) {
+    const int64_t B = batch.size();
+    const auto& shape = batch.front().images.sizes();
+    if (!images_.defined() || images_.sizes().slice(1) != shape) {
+        std::vector<int64_t> dims{int64_t(options_.max_batch)};
+        dims.insert(dims.end(), shape.begin(), shape.end());
+        images_ = torch::empty(dims, torch::kUInt8);
+        state_ = torch::empty({int64_t(options_.max_batch), config_.state_dim});
+    }
+    for (int64_t i = 0; i < B; ++i) {
+        images_[i].copy_(batch[i].images);
+        state_[i].copy_(batch[i].state);
+    }
+
+    PolicyResponseHeader header;
+    torch::Tensor actions;
+    try {
+        actions = policy_(images_.narrow(0, 0, B), state_.narrow(0, 0, B)).to(torch::kFloat32).contiguous();
+        header.chunk_size = actions.size(1);
+        header.action_dim = actions.size(2);
+    } catch (const std::exception& e) {
+        std::cerr << "Policy forward failed: " << e.what() << "\n";
+        header.status = PolicyStatus::Error;
+    }
+
+    std::vector<double> latencies;
+    for (int64_t i = 0; i < B; ++i) {
+        header.id = batch[i].header.id;
+        respond(*batch[i].conn, header, actions.defined() ? actions[i].data_ptr<float>() : nullptr);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - batch[i].arrived).count());
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    latency_us_.insert(latency_us_.end(), latencies.begin(), latencies.end());
+}
+
+void PolicyServer::respond(Connection& conn, const PolicyResponseHeader& header, const float* actions) {
+    std::lock_guard<std::mutex> lock(conn.write_mutex);
+    if (conn.fd < 0 || !write_all(conn.fd, &header, sizeof(header))) return;
+    if (header.status == PolicyStatus::Ok)
+        write_all(conn.fd, actions, sizeof(float) * header.chunk_size * header.action_dim);
+}
+
+void PolicyServer::report(std::ostream& out) {
+    std::vector<double> latency;
+    std::vector<uint64_t> sizes;
+    uint64_t batches, depth_sum, depth_max;
+    double seconds;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        latency.swap(latency_us_);
+        sizes = batch_sizes_;
+        std::fill(batch_sizes_.begin(), batch_sizes_.end(), 0);
+        batches = batches_;
+        depth_sum = depth_sum_;
+        depth_max = depth_max_;
+        batches_ = depth_sum_ = depth_max_ = 0;
+        auto now = Clock::now();
+        seconds = std::chrono::duration<double>(now - last_report_).count();
+        last_report_ = now;
+    }
+    size_t connections;
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex_);
+        connections = connections_.size();
+    }
+    std::sort(latency.begin(), latency.end());
+    if (batches == 0) {
+        out << "policy server: idle (" << connections << " connections)\n";
+        return;
+    }
+
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(1) << "policy server: " << latency.size() / seconds << " req/s, "
+        << batches / seconds << " batches/s, mean batch " << double(latency.size()) / batches
+        << ", queue depth mean " << double(depth_sum) / batches << " max " << depth_max
+        << " | latency us p50 " << percentile(latency, 0.5) << " p99 " << percentile(latency, 0.99)
+        << " max " << percentile(latency, 1.0) << "\n  batch sizes:";
+    for (size_t b = 1; b < sizes.size(); ++b)
+        if (sizes[b]) out << " " << b << "x" << sizes[b];
+    out << "\n";
+    out.flags(flags);
+}
+
+// --- PolicyClient ---
+
+PolicyClient::PolicyClient(const std::string& socket_path) {
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    auto addr = unix_address(socket_path);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        if (fd_ >= 0) ::close(fd_);
+        throw std::runtime_error("Cannot connect to policy server at " + socket_path + ": " + std::strerror(errno));
+    }
+}
+
+PolicyClient::~PolicyClient() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+torch::Tensor PolicyClient::act(const torch::Tensor& images, const torch::Tensor& state) {
+    auto img = images.to(torch::kUInt8).contiguous();
+    auto s = state.to(torch::kFloat32).contiguous();
+    PolicyRequestHeader req;
+    req.id = next_id_++;
+    req.history = img.size(0);
+    req.height = img.size(2);
+    req.width = img.size(3);
+    req.state_dim = s.numel();
+    if (!write_all(fd_, &req, sizeof(req)) || !write_all(fd_, img.data_ptr(), img.nbytes()) ||
+        !write_all(fd_, s.data_ptr(), s.nbytes()))
+        throw std::runtime_error("Policy server connection lost");
+
+    PolicyResponseHeader resp;
+    if (!read_all(fd_, &resp, sizeof(resp)) || resp.magic != POLICY_RESPONSE_MAGIC)
+        throw std::runtime_error("Policy server connection lost");
+    if (resp.status != PolicyStatus::Ok)
+        throw std::runtime_error(resp.status == PolicyStatus::BadRequest ? "Policy server rejected the request"
+                                                                         : "Policy server failed the request");
+    if (resp.id != req.id) throw std::runtime_error("Policy server answered the wrong request");
+    auto actions = torch::empty({int64_t(resp.chunk_size), int64_t(resp.action_dim)});
+    if (!read_all(fd_, actions.data_ptr(), actions.nbytes())) throw std::runtime_error("Policy server connection lost");
+    return actions;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "policy_export.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One policy shared by several local processes. Clients send observations
+// over a Unix domain socket; requests that arrive within window_us of the
+// oldest queued one are coalesced (up to max_batch, same image shape) into
+// a single batched forward and every client gets its own rows back.
+//
+// Wire format, native endianness, one request in flight per connection:
+//   request:  PolicyRequestHeader, images [T, 3, H, W] uint8, state [state_dim] float32 (raw units)
+//   response: PolicyResponseHeader, actions [chunk_size, action_dim] float32 (dataset units)
+
+constexpr uint32_t POLICY_REQUEST_MAGIC = 0x5150524C;   // "LRPQ"
+constexpr uint32_t POLICY_RESPONSE_MAGIC = 0x5250524C;  // "LRPR"
+
+struct PolicyRequestHeader {
+    uint32_t magic = POLICY_REQUEST_MAGIC;
+    uint32_t id = 0;  // echoed back
+    uint32_t history = 0, height = 0, width = 0;
+    uint32_t state_dim = 0;
+};
+
+enum class PolicyStatus : uint32_t { Ok = 0, BadRequest = 1, Error = 2 };
+
+struct PolicyResponseHeader {
+    uint32_t magic = POLICY_RESPONSE_MAGIC;
+    uint32_t id = 0;
+    PolicyStatus status = PolicyStatus::Ok;
+    uint32_t chunk_size = 0, action_dim = 0;  // 0 unless status is Ok
+};
+
+struct PolicyServerOptions {
+    std::string socket_path = "/tmp/lerobot_policy.sock";
+    size_t max_batch = 32;
+    int64_t window_us = 2000;  // longest a request waits for company
+};
+
+class PolicyServer {
+public:
+    PolicyServer(BatchedPolicy policy, const ACTConfig& config, PolicyServerOptions options = {});
+    ~PolicyServer();
+    PolicyServer(const PolicyServer&) = delete;
+    PolicyServer& operator=(const PolicyServer&) = delete;
+
+    void start();  // binds the socket, starts the accept and batching threads
+    void stop();   // closes every connection and joins the threads
+
+    // Queue depth, batch-size distribution and per-request latency (arrival
+    // to response sent) since the previous report
+    void report(std::ostream& out);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Connection {
+        int fd = -1;  // -1 once the reader has closed it, under write_mutex
+        std::mutex write_mutex;
+        bool done = false;  // reader is about to return, under conn_mutex_
+    };
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<Connection> conn;
+    };
+    struct Request {
+        std::shared_ptr<Connection> conn;
+        PolicyRequestHeader header;
+        torch::Tensor images;  // [T, 3, H, W] uint8
+        torch::Tensor state;   // [state_dim] float32
+        Clock::time_point arrived;
+    };
+
+    BatchedPolicy policy_;
+    ACTConfig config_;
+    PolicyServerOptions options_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread accept_thread_, batch_thread_;
+
+    std::mutex conn_mutex_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+    std::vector<Reader> readers_;  // finished ones are joined on the next accept
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Request> queue_;
+
+    // batching buffers, reused while the request shape stays the same
+    torch::Tensor images_, state_;
+
+    std::mutex stats_mutex_;
+    std::vector<uint64_t> batch_sizes_;  // histogram, index = batch size
+    std::vector<double> latency_us_;
+    uint64_t depth_sum_ = 0, depth_max_ = 0, batches_ = 0;
+    Clock::time_point last_report_ = Clock::now();
+
+    void accept_loop();
+    void read_loop(std::shared_ptr<Connection> conn);
+    void receive(const std::shared_ptr<Connection>& conn);
+    void batch_loop();
+    void run_batch(std::vector<Request>& batch);
+    void respond(Connection& conn, const PolicyResponseHeader& header, const float* actions);
+};
+
+// Blocking client for PolicyServer, one request at a time
+class PolicyClient {
+public:
+    explicit PolicyClient(const std::string& socket_path);
+    ~PolicyClient();
+    PolicyClient(const PolicyClient&) = delete;
+    PolicyClient& operator=(const PolicyClient&) = delete;
+
+    // images [T, 3, H, W] uint8, state [state_dim] raw -> [chunk_size, action_dim]
+    torch::Tensor act(const torch::Tensor& images, const torch::Tensor& state);
+
+private:
+    int fd_ = -1;
+    uint32_t next_id_ = 0;
+};
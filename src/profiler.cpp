@@ -0,0 +1,186 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* stage;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// One per thread. Only its owner appends and report() swaps the vector out,
+// so the mutex is uncontended except during a report.
+struct ThreadBuffer {
+    int tid = 0;
+    std::string name;
+    bool name_written = false;
+    std::mutex mutex;
+    std::vector<Event> events;
+};
+
+struct Registry {
+    std::mutex mutex;  // guards buffers, trace and last_report_ns
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;  // outlive their threads until drained
+    std::ofstream trace;
+    bool first_trace_event = true;
+    int64_t last_report_ns = 0;
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+ThreadBuffer& thread_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto b = std::make_shared<ThreadBuffer>();
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        b->tid = r.buffers.size();
+        b->name = "thread " + std::to_string(b->tid);
+        r.buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+// expects registry().mutex held
+void write_trace_event(Registry& r, const nlohmann::json& event) {
+    if (!r.trace.is_open()) return;
+    r.trace << (r.first_trace_event ? "\n" : ",\n") << event.dump();
+    r.first_trace_event = false;
+}
+
+// Swaps every thread's events out; writes them to the trace if one is open.
+// Expects registry().mutex held.
+std::vector<Event> drain(Registry& r) {
+    std::vector<Event> all;
+    const int pid = ::getpid();
+    for (auto& b : r.buffers) {
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> lock(b->mutex);
+            events.swap(b->events);
+        }
+        if (r.trace.is_open()) {
+            if (!b->name_written) {
+                write_trace_event(r, {{"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", b->tid},
+                                      {"args", {{"name", b->name}}}});
+                b->name_written = true;
+            }
+            for (const auto& e : events)
+                write_trace_event(r, {{"name", e.stage}, {"ph", "X"}, {"pid", pid}, {"tid", b->tid},
+                                      {"ts", e.start_ns / 1000.0}, {"dur", e.duration_ns / 1000.0}});
+        }
+        all.insert(all.end(), events.begin(), events.end());
+    }
+    return all;
+}
+
+}  // namespace
+
+int64_t Profiler::now_ns() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point origin = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+void Profiler::record(const char* stage, int64_t start_ns, int64_t duration_ns) {
+    auto& b = thread_buffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.events.push_back({stage, start_ns, duration_ns});
+}
+
+void Profiler::name_thread(const std::string& name) {
+    auto& b = thread_buffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    b.name = name;
+}
+
+void Profiler::open_trace(const fs::path& path) {
+    auto& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.trace.open(path);
+        if (!r.trace) throw std::runtime_error("Cannot write trace " + path.string());
+        r.trace << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        r.first_trace_event = true;
+        for (auto& b : r.buffers) b->name_written = false;
+    }
+    set_enabled(true);
+    std::cout << "Writing trace to " << path << "\n";
+}
+
+void Profiler::close_trace() {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.trace.is_open()) return;
+    drain(r);
+    r.trace << "\n]}\n";
+    r.trace.close();
+}
+
+void Profiler::report(std::ostream& out) {
+    auto& r = registry();
+    std::vector<Event> events;
+    int64_t interval_ns;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        events = drain(r);
+        const int64_t now = now_ns();
+        interval_ns = std::max<int64_t>(1, now - r.last_report_ns);
+        r.last_report_ns = now;
+    }
+
+    std::map<std::string, std::vector<double>> by_stage;
+    for (const auto& e : events) by_stage[e.stage].push_back(double(e.duration_ns));
+
+    struct Row {
+        std::string stage;
+        size_t calls;
+        double total_ms, mean_us, p50_us, p99_us, max_us;
+    };
+    std::vector<Row> rows;
+    for (auto& [stage, d] : by_stage) {
+        std::sort(d.begin(), d.end());
+        double total = 0;
+        for (double v : d) total += v;
+        rows.push_back({stage, d.size(), total / 1e6, total / d.size() / 1e3, percentile(d, 0.5) / 1e3,
+                        percentile(d, 0.99) / 1e3, d.back() / 1e3});
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.total_ms > b.total_ms; });
+
+    const double interval_s = interval_ns * 1e-9;
+    out << "  " << std::left << std::setw(22) << "stage" << std::right << std::setw(9) << "calls/s"
+        << std::setw(11) << "mean us" << std::setw(11) << "p50 us" << std::setw(11) << "p99 us"
+        << std::setw(11) << "max us" << std::setw(8) << "busy%" << "\n";
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+    for (const auto& row : rows) {
+        // busy% sums over threads, so stages run by several workers can exceed 100
+        out << "  " << std::left << std::setw(22) << row.stage << std::right << std::setw(9)
+            << row.calls / interval_s << std::setw(11) << row.mean_us << std::setw(11) << row.p50_us
+            << std::setw(11) << row.p99_us << std::setw(11) << row.max_us << std::setw(8)
+            << 100.0 * row.total_ms / 1e3 / interval_s << "\n";
+    }
+    out.flags(flags);
+}
+
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
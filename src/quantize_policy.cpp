@@ -0,0 +1,175 @@
+#include "policy_export.h"
+#include "dataset.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Usage: quantize_policy [--dataset data/pusht] [--precision fp32,int8,bf16]
+//                        [--max-frames 1024] [--threads 1] [--out-dir checkpoints]
+//
+// Exports checkpoints/act_final.pt in each precision (act_final_<p>.ts) and
+// reports, per variant, the action-chunk MSE (normalized units) on the
+// held-out episodes recorded in act_config.json, median B=1 latency and
+// serialized model size.
+
+namespace {
+
+struct Options {
+    std::string dataset = "data/pusht";
+    std::vector<PolicyPrecision> precisions{PolicyPrecision::FP32, PolicyPrecision::INT8, PolicyPrecision::BF16};
+    size_t max_frames = 1024;
+    int threads = 1;
+    fs::path out_dir = "checkpoints";
+};
+
+Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+        std::string v = argv[++i];
+        if (arg == "--dataset") o.dataset = v;
+        else if (arg == "--max-frames") o.max_frames = std::stoul(v);
+        else if (arg == "--threads") o.threads = std::stoi(v);
+        else if (arg == "--out-dir") o.out_dir = v;
+        else if (arg == "--precision") {
+            o.precisions.clear();
+            std::stringstream ss(v);
+            for (std::string name; std::getline(ss, name, ',');) o.precisions.push_back(parse_precision(name));
+        } else {
+            throw std::invalid_argument("Unknown argument " + arg);
+        }
+    }
+    return o;
+}
+
+// Held-out frames, evenly subsampled, gathered once so every variant sees
+// the same decoded inputs
+std::vector<Batch> held_out_batches(const Options& o, const ACTConfig& config) {
+    LeRobotDataset dataset(o.dataset, {{"observation.image", config.image_deltas},
+                                       {"action", config.action_deltas}});
+    const size_t total = dataset.size().value();
+    size_t first = config.train_frames;
+    if (first == 0 || first >= total) {
+        std::cerr << "No held-out episodes recorded in the config, evaluating on the last 10% of frames\n";
+        first = total - total / 10;
+    }
+    const size_t count = std::min(o.max_frames, total - first);
+    std::cout << "Evaluating on " << count << " of " << total - first << " held-out frames\n";
+
+    std::vector<Batch> batches;
+    const size_t B = 32;
+    for (size_t start = 0; start < count; start += B) {
+        std::vector<int64_t> indices;
+        for (size_t i = start; i < std::min(count, start + B); ++i)
+            indices.push_back(first + i * (total - first) / count);
+        Batch batch = dataset.get_batch(torch::tensor(indices, torch::kInt64));
+        batch.images = dataset.load_window_images(batch.image_rows);
+        if (!batch.images.defined())  // no videos: the gray frames train.cpp substitutes
+            batch.images = torch::full({int64_t(indices.size()), int64_t(config.image_deltas.size()), 3, 96, 96},
+                                       128, torch::kUInt8);
+        batches.push_back(std::move(batch));
+    }
+    return batches;
+}
+
+struct Result {
+    std::string name;
+    double mse = 0.0;          // masked chunk MSE, normalized action units
+    double first_mse = 0.0;    // first action of the chunk only
+    double latency_us = 0.0;   // median, B = 1
+    double size_mb = 0.0;
+};
+
+template <typename Fn>
+Result evaluate(const std::string& name, Fn&& forward, const std::vector<Batch>& batches, const ACTConfig& config) {
+    Result r;
+    r.name = name;
+    auto scale = config.action_std + 1e-5;
+    double err = 0.0, n = 0.0, first_err = 0.0, first_n = 0.0;
+    for (const auto& b : batches) {
+        auto pred = forward(b.images, b.state);
+        auto sq = ((pred - b.action_chunk) / scale).pow(2).mean(-1);  // [B, k]
+        auto mask = b.action_chunk_mask.to(torch::kFloat32);
+        err += (sq * mask).sum().item<double>();
+        n += mask.sum().item<double>();
+        first_err += sq.select(1, 0).sum().item<double>();
+        first_n += sq.size(0);
+    }
+    r.mse = err / std::max(n, 1.0);
+    r.first_mse = first_err / std::max(first_n, 1.0);
+
+    auto images = batches.front().images.slice(0, 0, 1).contiguous();
+    auto state = batches.front().state.slice(0, 0, 1).contiguous();
+    for (int i = 0; i < 20; ++i) forward(images, state);
+    std::vector<double> us;
+    for (int i = 0; i < 200; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        forward(images, state);
+        us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::nth_element(us.begin(), us.begin() + us.size() / 2, us.end());
+    r.latency_us = us[us.size() / 2];
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    torch::set_num_threads(o.threads);
+
+    ACTConfig config = ACTConfig::load(o.out_dir / "act_config.json");
+    ACTPolicy policy = config.make_policy();
+    torch::load(policy, (o.out_dir / "act_final.pt").string());
+    policy->eval();
+
+    auto batches = held_out_batches(o, config);
+    if (batches.empty()) {
+        std::cerr << "No held-out frames to evaluate\n";
+        return 1;
+    }
+
+    torch::InferenceMode inference_mode;
+    std::vector<Result> results;
+
+    auto eager = [&](const torch::Tensor& images, const torch::Tensor& state) {
+        auto s = (state - config.state_mean) / (config.state_std + 1e-5);
+        return policy->forward(images, s) * (config.action_std + 1e-5) + config.action_mean;
+    };
+    results.push_back(evaluate("eager fp32", eager, batches, config));
+    size_t param_bytes = 0;
+    for (const auto& p : policy->parameters()) param_bytes += p.numel() * p.element_size();
+    results.back().size_mb = param_bytes / 1e6;
+
+    for (auto precision : o.precisions) {
+        fs::path path = o.out_dir / (std::string("act_final_") + precision_name(precision) + ".ts");
+        freeze_policy(policy, config, precision).save(path.string());
+        auto module = load_optimized_policy(path);
+        auto forward = [&](const torch::Tensor& images, const torch::Tensor& state) {
+            return module.forward({images, state}).toTensor();
+        };
+        results.push_back(evaluate(std::string("frozen ") + precision_name(precision), forward, batches, config));
+        results.back().size_mb = fs::file_size(path) / 1e6;
+        std::cout << "Saved " << path << "\n";
+    }
+
+    std::cout << "\n" << std::left << std::setw(14) << "variant" << std::right << std::setw(12) << "chunk MSE"
+              << std::setw(12) << "first MSE" << std::setw(14) << "p50 B=1 (us)" << std::setw(10) << "size MB"
+              << "\n" << std::fixed;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(14) << r.name << std::right << std::setprecision(5)
+                  << std::setw(12) << r.mse << std::setw(12) << r.first_mse << std::setprecision(1)
+                  << std::setw(14) << r.latency_us << std::setprecision(2) << std::setw(10) << r.size_mb << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "sampler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+FeistelPermutation::FeistelPermutation(uint64_t n, uint64_t key) : n_(n) {
+    if (n == 0) throw std::invalid_argument("FeistelPermutation over an empty range");
+    int bits = 2;
+    while (bits < 64 && (uint64_t(1) << bits) < n) ++bits;
+    if (bits % 2) ++bits;  // both halves the same width
+    half_bits_ = bits / 2;
+    half_mask_ = (uint64_t(1) << half_bits_) - 1;
+    for (int r = 0; r < 4; ++r) {
+        key = splitmix64(key);
+        keys_[r] = key;
+    }
+}
+
+uint64_t FeistelPermutation::encrypt(uint64_t x) const {
+    uint64_t left = x >> half_bits_;
+    uint64_t right = x & half_mask_;
+    for (uint64_t k : keys_) {
+        uint64_t next = left ^ (splitmix64(right ^ k) & half_mask_);
+        left = right;
+        right = next;
+    }
+    return (left << half_bits_) | right;
+}
+
+uint64_t FeistelPermutation::operator()(uint64_t x) const {
+    // the cycle through x always returns below n_, so this terminates;
+    // the domain is < 4n, so a handful of rounds on average
+    do {
+        x = encrypt(x);
+    } while (x >= n_);
+    return x;
+}
+
+size_t RandomSampler::index_at(uint64_t position) const {
+    uint64_t epoch = position / size_;
+    uint64_t offset = position % size_;
+    if (!shuffle_) return offset;
+    return FeistelPermutation(size_, splitmix64(seed_) ^ epoch)(offset);
+}
+
+// --- BlockShuffleSampler ---
+
+BlockShuffleSampler::BlockShuffleSampler(size_t size, std::vector<size_t> episode_starts, uint64_t seed,
+                                         BlockShuffleOptions options)
+    : size_(size), episode_starts_(std::move(episode_starts)), seed_(seed), options_(options) {
+    if (size_ == 0) throw std::invalid_argument("BlockShuffleSampler over an empty range");
+    if (size_ > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("BlockShuffleSampler: more than 2^32 frames");
+    options_.block_size = std::max<size_t>(options_.block_size, 1);
+    options_.buffer_blocks = std::max<size_t>(options_.buffer_blocks, 1);
+    if (episode_starts_.empty() || episode_starts_.front() != 0) episode_starts_.insert(episode_starts_.begin(), 0);
+}
+
+std::shared_ptr<const BlockShuffleSampler::Epoch> BlockShuffleSampler::build(uint64_t epoch) const {
+    std::mt19937_64 rng(splitmix64(seed_) ^ splitmix64(epoch));
+    const size_t L = options_.block_size;
+
+    // --- Blocks: [begin, end) runs inside each segment, random phase ---
+    std::vector<std::pair<uint32_t, uint32_t>> blocks;
+    auto cut = [&](size_t begin, size_t end) {
+        size_t b = begin;
+        size_t first = std::min(end, begin + 1 + rng() % L);  // phase: first block is 1..L frames
+        for (size_t e = first; b < end; b = e, e = std::min(end, e + L)) blocks.emplace_back(b, e);
+    };
+    if (options_.episode_aligned) {
+        for (size_t i = 0; i < episode_starts_.size(); ++i) {
+            size_t end = i + 1 < episode_starts_.size() ? episode_starts_[i + 1] : size_;
+            if (episode_starts_[i] < std::min(end, size_)) cut(episode_starts_[i], std::min(end, size_));
+        }
+    } else {
+        cut(0, size_);
+    }
+    std::shuffle(blocks.begin(), blocks.end(), rng);
+
+    // --- Interleave buffer_blocks blocks at a time, each front to back ---
+    auto e = std::make_shared<Epoch>();
+    e->epoch = epoch;
+    e->order.reserve(size_);
+    for (size_t g = 0; g < blocks.size(); g += options_.buffer_blocks) {
+        std::vector<std::pair<uint32_t, uint32_t>> live(blocks.begin() + g,
+                                                        blocks.begin() + std::min(blocks.size(), g + options_.buffer_blocks));
+        size_t remaining = 0;
+        for (const auto& [b, end] : live) remaining += end - b;
+        // drawing blocks weighted by frames left makes every interleaving equally likely
+        for (; remaining > 0; --remaining) {
+            size_t r = rng() % remaining;
+            size_t k = 0;
+            for (; r >= live[k].second - live[k].first; ++k) r -= live[k].second - live[k].first;
+            e->order.push_back(live[k].first++);
+        }
+    }
+    return e;
+}
+
+size_t BlockShuffleSampler::index_at(uint64_t position) const {
+    const uint64_t epoch = position / size_;
+    auto& slot = cache_[epoch % 2];
+    auto e = std::atomic_load(&slot);
+    if (!e || e->epoch != epoch) {
+        // threads crossing into a new epoch may each build it; the result is the same
+        e = build(epoch);
+        std::atomic_store(&slot, e);
+    }
+    return e->order[position % size_];
+}
+
+double mean_seek_distance(const Sampler& sampler, const std::vector<size_t>& episode_starts,
+                          size_t draws, size_t streams) {
+    struct Stream {
+        size_t episode = std::numeric_limits<size_t>::max();
+        size_t position = 0;  // next frame, relative to the episode start
+        uint64_t last_used = 0;
+    };
+    std::vector<Stream> decoders(std::max<size_t>(streams, 1));
+    draws = std::min<size_t>(draws, sampler.size());
+    double total = 0.0;
+    for (uint64_t p = 0; p < draws; ++p) {
+        const size_t index = sampler.index_at(p);
+        auto it = std::upper_bound(episode_starts.begin(), episode_starts.end(), index);
+        const size_t ep = it == episode_starts.begin() ? 0 : size_t(it - episode_starts.begin()) - 1;
+        const size_t frame = index - (episode_starts.empty() ? 0 : episode_starts[ep]);
+
+        Stream* best = nullptr;
+        for (auto& d : decoders)
+            if (d.episode == ep && d.position <= frame && (!best || d.position > best->position)) best = &d;
+        if (!best) {  // nothing positioned before the target: reuse the LRU decoder
+            best = &*std::min_element(decoders.begin(), decoders.end(),
+                                      [](const Stream& a, const Stream& b) { return a.last_used < b.last_used; });
+            if (best->episode != ep) best->position = 0;  // freshly opened
+            best->episode = ep;
+        }
+        total += double(std::max(frame, best->position) - std::min(frame, best->position));
+        best->position = frame + 1;
+        best->last_used = p + 1;
+    }
+    return draws ? total / draws : 0.0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Samplers map a position in an endless stream of draws to a dataset index.
+// index_at() is const and stateless, so loader workers can share one sampler
+// and claim positions with a single atomic increment instead of a lock.
+class Sampler {
+public:
+    virtual ~Sampler() = default;
+    virtual size_t size() const = 0;                      // draws per epoch
+    virtual size_t index_at(uint64_t position) const = 0;
+};
+
+// Pseudo-random permutation of [0, n) without materializing it: a 4-round
+// Feistel network over the next even power of two, cycle-walking any value
+// that lands outside [0, n).
+class FeistelPermutation {
+public:
+    FeistelPermutation(uint64_t n, uint64_t key);
+    uint64_t operator()(uint64_t x) const;
+
+private:
+    uint64_t n_;
+    int half_bits_ = 1;
+    uint64_t half_mask_ = 1;
+    uint64_t keys_[4];
+
+    uint64_t encrypt(uint64_t x) const;
+};
+
+uint64_t splitmix64(uint64_t x);
+
+// Uniform sampling without replacement, reshuffled every epoch.
+class RandomSampler : public Sampler {
+public:
+    RandomSampler(size_t size, uint64_t seed = 0, bool shuffle = true)
+        : size_(size), seed_(seed), shuffle_(shuffle) {}
+
+    size_t size() const override { return size_; }
+    size_t index_at(uint64_t position) const override;
+
+private:
+    size_t size_;
+    uint64_t seed_;
+    bool shuffle_;
+};
+
+// Another sampler's indices shifted into [first, first + base->size()),
+// e.g. one data-parallel worker's shard of the dataset.
+class RangeSampler : public Sampler {
+public:
+    RangeSampler(std::shared_ptr<Sampler> base, size_t first) : base_(std::move(base)), first_(first) {}
+
+    size_t size() const override { return base_->size(); }
+    size_t index_at(uint64_t position) const override { return first_ + base_->index_at(position); }
+
+private:
+    std::shared_ptr<Sampler> base_;
+    size_t first_;
+};
+
+struct BlockShuffleOptions {
+    size_t block_size = 64;       // contiguous frames visited in ascending order
+    size_t buffer_blocks = 16;    // blocks interleaved at a time
+    bool episode_aligned = true;  // blocks never straddle an episode boundary
+};
+
+// Epoch-based shuffle that keeps video decoding local. Each epoch the
+// frames are cut into blocks of block_size contiguous frames (at a random
+// phase, so block contents change between epochs), the blocks are shuffled,
+// and buffer_blocks of them at a time are randomly interleaved, each block
+// read front to back. A decoder following one block only ever steps a few
+// frames forward, while a batch still mixes frames from many episodes.
+// The epoch's order is built on first use (O(size)) and cached for the
+// current and previous epoch, so index_at() stays lock-free.
+class BlockShuffleSampler : public Sampler {
+public:
+    // episode_starts: first frame of every episode in [0, size), ascending
+    BlockShuffleSampler(size_t size, std::vector<size_t> episode_starts, uint64_t seed = 0,
+                        BlockShuffleOptions options = {});
+
+    size_t size() const override { return size_; }
+    size_t index_at(uint64_t position) const override;
+
+private:
+    struct Epoch {
+        uint64_t epoch;
+        std::vector<uint32_t> order;
+    };
+
+    size_t size_;
+    std::vector<size_t> episode_starts_;
+    uint64_t seed_;
+    BlockShuffleOptions options_;
+    mutable std::shared_ptr<const Epoch> cache_[2];  // by epoch parity, std::atomic_load/store only
+
+    std::shared_ptr<const Epoch> build(uint64_t epoch) const;
+};
+
+// Mean |target - position| in frames when `streams` decoders (one episode
+// video each, reused like DecoderPool: the nearest one at or before the
+// target, else the least recently used) serve the first `draws` indices of
+// a sampler. 0 for a sequential read; compares samplers without decoding.
+double mean_seek_distance(const Sampler& sampler, const std::vector<size_t>& episode_starts,
+                          size_t draws = 20000, size_t streams = 16);
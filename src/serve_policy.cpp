@@ -0,0 +1,90 @@
+#include "policy_server.h"
+#include <torch/torch.h>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Usage: serve_policy [--checkpoint checkpoints/act_final.pt] [--config checkpoints/act_config.json]
+//                     [--script checkpoints/act_final.ts] [--socket /tmp/lerobot_policy.sock]
+//                     [--max-batch 32] [--window-us 2000] [--threads 1] [--report-every 5]
+//
+// Serves one policy to every local client on a Unix socket, batching
+// requests that arrive close together into one forward (see policy_server.h
+// for the wire format; bench_policy_server is a matching load generator).
+// Prints queue depth, batch sizes and request latency every --report-every
+// seconds; Ctrl-C stops.
+
+namespace {
+
+struct Options {
+    std::string checkpoint = "checkpoints/act_final.pt";
+    std::string config = "checkpoints/act_config.json";
+    std::string script;
+    PolicyServerOptions server;
+    int threads = 1;
+    int report_every = 5;
+};
+
+Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--checkpoint") o.checkpoint = value();
+        else if (arg == "--config") o.config = value();
+        else if (arg == "--script") o.script = value();
+        else if (arg == "--socket") o.server.socket_path = value();
+        else if (arg == "--max-batch") o.server.max_batch = std::stoul(value());
+        else if (arg == "--window-us") o.server.window_us = std::stoll(value());
+        else if (arg == "--threads") o.threads = std::stoi(value());
+        else if (arg == "--report-every") o.report_every = std::stoi(value());
+        else throw std::invalid_argument("Unknown argument " + arg);
+    }
+    return o;
+}
+
+volatile std::sig_atomic_t interrupted = 0;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // Batching is where the parallelism comes from; keep the kernels' pool fixed
+    torch::set_num_threads(o.threads);
+    at::set_num_interop_threads(1);
+
+    ACTConfig config = ACTConfig::load(o.config);
+    BatchedPolicy forward = load_batched_policy(config, o.checkpoint, o.script);
+    std::cout << "Loaded " << (o.script.empty() ? o.checkpoint : o.script) << " (chunk_size=" << config.chunk_size
+              << ", T=" << config.image_deltas.size() << ", threads=" << torch::get_num_threads() << ")\n";
+
+    PolicyServer server(forward, config, o.server);
+    server.start();
+
+    std::signal(SIGINT, [](int) { interrupted = 1; });
+    std::signal(SIGTERM, [](int) { interrupted = 1; });
+    auto next_report = std::chrono::steady_clock::now() + std::chrono::seconds(o.report_every);
+    while (!interrupted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() >= next_report) {
+            server.report(std::cout);
+            next_report += std::chrono::seconds(o.report_every);
+        }
+    }
+    std::cout << "Stopping\n";
+    server.report(std::cout);
+    server.stop();
+    return 0;
+}
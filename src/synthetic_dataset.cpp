@@ -0,0 +1,198 @@
+#include "synthetic_dataset.h"
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/writer.h>
+#include <nlohmann/json.hpp>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+static constexpr double WORKSPACE = 512.0;  // state units, Push-T's workspace
+
+static std::string numbered(const char* fmt, int n) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), fmt, n);
+    return buf;
+}
+
+static void check(const arrow::Status& status) {
+    if (!status.ok()) throw std::runtime_error("Synthetic dataset: " + status.ToString());
+}
+
+// [rows, dim] row-major floats -> fixed_size_list<float>[dim]
+static std::shared_ptr<arrow::Array> fsl_array(const std::vector<float>& values, int dim) {
+    auto value_builder = std::make_shared<arrow::FloatBuilder>();
+    arrow::FixedSizeListBuilder builder(arrow::default_memory_pool(), value_builder, dim);
+    const int64_t rows = values.size() / dim;
+    check(builder.Reserve(rows));
+    check(value_builder->Reserve(values.size()));
+    for (int64_t r = 0; r < rows; ++r) {
+        check(builder.Append());
+        check(value_builder->AppendValues(values.data() + r * dim, dim));
+    }
+    std::shared_ptr<arrow::Array> out;
+    check(builder.Finish(&out));
+    return out;
+}
+
+template <typename Builder, typename T>
+static std::shared_ptr<arrow::Array> scalar_array(const std::vector<T>& values) {
+    Builder builder;
+    check(builder.AppendValues(values));
+    std::shared_ptr<arrow::Array> out;
+    check(builder.Finish(&out));
+    return out;
+}
+
+// Smooth random walk of every dim inside the workspace, bouncing off its
+// walls. Returns [frames + 1, dim] so actions can be read one frame ahead.
+static std::vector<float> random_walk(std::mt19937_64& rng, int frames, int dim) {
+    std::normal_distribution<double> noise(0.0, 4.0);
+    std::uniform_real_distribution<double> start(0.2 * WORKSPACE, 0.8 * WORKSPACE);
+    std::vector<double> pos(dim), vel(dim, 0.0);
+    for (auto& p : pos) p = start(rng);
+
+    std::vector<float> out;
+    out.reserve(size_t(frames + 1) * dim);
+    for (int f = 0; f <= frames; ++f) {
+        for (int d = 0; d < dim; ++d) {
+            vel[d] = 0.9 * vel[d] + noise(rng);
+            pos[d] += vel[d];
+            if (pos[d] < 0 || pos[d] > WORKSPACE) {  // bounce off the walls
+                vel[d] = -vel[d];
+                pos[d] = std::clamp(pos[d], 0.0, WORKSPACE);
+            }
+            out.push_back(static_cast<float>(pos[d]));
+        }
+    }
+    return out;
+}
+
+// the first two dims of each state row place the target
+static void write_video(const fs::path& path, const std::vector<float>& states, int frames, int state_dim,
+                        const SyntheticDatasetOptions& o, std::mt19937_64& rng) {
+    cv::VideoWriter writer(path.string(), cv::VideoWriter::fourcc('m', 'p', '4', 'v'), o.fps,
+                           cv::Size(o.width, o.height));
+    if (!writer.isOpened()) throw std::runtime_error("Cannot open video writer for " + path.string());
+
+    // static textured background, so frames don't compress to nothing
+    cv::Mat background(o.height, o.width, CV_8UC3);
+    cv::theRNG().state = rng();
+    cv::randu(background, cv::Scalar::all(60), cv::Scalar::all(200));
+    cv::GaussianBlur(background, background, cv::Size(5, 5), 0);
+
+    const double sx = o.width / WORKSPACE, sy = o.height / WORKSPACE;
+    const int radius = std::max(2, std::min(o.width, o.height) / 12);
+    cv::Mat frame;
+    for (int f = 0; f < frames; ++f) {
+        background.copyTo(frame);
+        const float* s = states.data() + size_t(f) * state_dim;
+        cv::Point target(int(s[0] * sx), int((state_dim > 1 ? s[1] : s[0]) * sy));
+        cv::circle(frame, target, radius, cv::Scalar(40, 40, 220), cv::FILLED);
+        cv::putText(frame, std::to_string(f), cv::Point(2, o.height - 4), cv::FONT_HERSHEY_PLAIN, 0.8,
+                    cv::Scalar::all(255));
+        writer.write(frame);
+    }
+}
+
+void write_synthetic_dataset(const fs::path& root, const SyntheticDatasetOptions& o) {
+    if (o.episodes <= 0 || o.frames_per_episode <= 0 || o.state_dim <= 0 || o.action_dim <= 0)
+        throw std::invalid_argument("Synthetic dataset needs positive episodes, frames and dims");
+    const fs::path abs_root = fs::absolute(root);
+    fs::create_directories(abs_root / "meta");
+    fs::create_directories(abs_root / "videos");  // LeRobotDataset lists it even without videos
+
+    std::mt19937_64 rng(o.seed);
+    int64_t index = 0;
+    std::ofstream episodes_out(abs_root / "meta" / "episodes.jsonl");
+    for (int ep = 0; ep < o.episodes; ++ep) {
+        const std::string chunk = numbered("chunk-%03d", ep / o.episodes_per_chunk);
+        const std::string name = numbered("episode_%06d", ep);
+        const int n = o.frames_per_episode;
+
+        const int walk_dim = std::max(o.state_dim, o.action_dim);
+        auto walk = random_walk(rng, n, walk_dim);
+        std::vector<float> state, action;
+        std::vector<double> timestamp;
+        std::vector<int64_t> frame_index, episode_index, global_index;
+        for (int f = 0; f < n; ++f) {
+            const float* now = walk.data() + size_t(f) * walk_dim;
+            state.insert(state.end(), now, now + o.state_dim);
+            action.insert(action.end(), now + walk_dim, now + walk_dim + o.action_dim);  // next frame
+            timestamp.push_back(f / o.fps);
+            frame_index.push_back(f);
+            episode_index.push_back(ep);
+            global_index.push_back(index++);
+        }
+
+        fs::path video = abs_root / "videos" / chunk / "observation.image" / (name + ".mp4");
+        if (o.videos) {
+            fs::create_directories(video.parent_path());
+            write_video(video, walk, n, walk_dim, o, rng);
+        }
+
+        auto schema = arrow::schema({
+            arrow::field("observation.state", arrow::fixed_size_list(arrow::float32(), o.state_dim)),
+            arrow::field("action", arrow::fixed_size_list(arrow::float32(), o.action_dim)),
+            arrow::field("timestamp", arrow::float64()),
+            arrow::field("frame_index", arrow::int64()),
+            arrow::field("episode_index", arrow::int64()),
+            arrow::field("index", arrow::int64()),
+        });
+        if (o.videos) schema = schema->WithMetadata(arrow::key_value_metadata({"video_path"}, {video.string()}));
+        auto table = arrow::Table::Make(schema, {
+            fsl_array(state, o.state_dim),
+            fsl_array(action, o.action_dim),
+            scalar_array<arrow::DoubleBuilder>(timestamp),
+            scalar_array<arrow::Int64Builder>(frame_index),
+            scalar_array<arrow::Int64Builder>(episode_index),
+            scalar_array<arrow::Int64Builder>(global_index),
+        });
+
+        fs::path data = abs_root / "data" / chunk / (name + ".parquet");
+        fs::create_directories(data.parent_path());
+        auto maybe_out = arrow::io::FileOutputStream::Open(data.string());
+        check(maybe_out.status());
+        auto props = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+        check(parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), *maybe_out,
+                                         o.row_group_rows > 0 ? o.row_group_rows : n,
+                                         parquet::default_writer_properties(), props));
+        check((*maybe_out)->Close());
+
+        episodes_out << json{{"episode_index", ep}, {"length", n}, {"tasks", {"synthetic"}}}.dump() << "\n";
+    }
+
+    json features = {
+        {"observation.state", {{"dtype", "float32"}, {"shape", {o.state_dim}}}},
+        {"action", {{"dtype", "float32"}, {"shape", {o.action_dim}}}},
+        {"timestamp", {{"dtype", "float32"}, {"shape", {1}}}},
+        {"frame_index", {{"dtype", "int64"}, {"shape", {1}}}},
+        {"episode_index", {{"dtype", "int64"}, {"shape", {1}}}},
+        {"index", {{"dtype", "int64"}, {"shape", {1}}}},
+    };
+    if (o.videos)
+        features["observation.image"] = {{"dtype", "video"}, {"shape", {o.height, o.width, 3}},
+                                         {"names", {"height", "width", "channel"}}};
+    json info = {
+        {"codebase_version", "v2.0"},
+        {"robot_type", "synthetic"},
+        {"fps", o.fps},
+        {"total_episodes", o.episodes},
+        {"total_frames", index},
+        {"chunks_size", o.episodes_per_chunk},
+        {"data_path", "data/chunk-{episode_chunk:03d}/episode_{episode_index:06d}.parquet"},
+        {"video_path", "videos/chunk-{episode_chunk:03d}/{video_key}/episode_{episode_index:06d}.mp4"},
+        {"features", features},
+    };
+    std::ofstream(abs_root / "meta" / "info.json") << info.dump(4) << "\n";
+    std::cout << "Wrote synthetic dataset " << abs_root << ": " << o.episodes << " episodes, " << index
+              << " frames" << (o.videos ? " with videos" : "") << "\n";
+}
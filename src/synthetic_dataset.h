@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct SyntheticDatasetOptions {
+    int episodes = 20;
+    int frames_per_episode = 200;
+    int episodes_per_chunk = 1000;  // data/chunk-XXX directories, as in LeRobot v2
+    int state_dim = 2;
+    int action_dim = 2;
+    int height = 96;
+    int width = 96;
+    double fps = 10.0;
+    int64_t row_group_rows = 0;     // 0 = one row group per file
+    bool videos = true;
+    uint64_t seed = 0;
+};
+
+// Writes a LeRobot v2 style dataset that LeRobotDataset loads like Push-T:
+//   data/chunk-XXX/episode_NNNNNN.parquet   observation.state / action as
+//       fixed_size_list<float>, timestamp, frame_index, episode_index, index;
+//       the schema's "video_path" metadata names the episode's video
+//   videos/chunk-XXX/observation.image/episode_NNNNNN.mp4   (mp4v)
+//   meta/info.json, meta/episodes.jsonl
+// States follow a smooth random walk (a target drifting around the image),
+// actions lead them by one frame, and each video frame draws the target on
+// a textured background, so decoders see realistic motion rather than flat
+// color. The same options and seed produce the same data.
+void write_synthetic_dataset(const fs::path& root, const SyntheticDatasetOptions& options);
@@ -1,97 +1,434 @@
 #include "dataset.h"
 #include "act_policy.h"
+#include "data_loader.h"
+#include "distributed.h"
+#include "feature_store.h"
+#include "profiler.h"
 #include <torch/torch.h>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <iomanip>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
 
-int main() {
-    namespace fs = std::filesystem;
-    fs::create_directories("checkpoints");
+namespace fs = std::filesystem;
 
+// Usage: train [--workers N] [--steps 100000] [--amp fp32|bf16] [--scaling] [--compare-amp]
+//              [--profile] [--trace trace.json] [--sampler random|block] [--seed 0]
+//              [--features data/pusht/features.lrft [--features-fp16]] [--backbone ckpt.pt]
+//   --workers N    data-parallel over N local processes (Gloo on loopback),
+//                  each training on a disjoint shard of the episodes
+//   --amp bf16     forward under CPU autocast in bfloat16; master weights,
+//                  Adam state, normalization and the loss stay float32
+//   --scaling      run --steps with 1, 2, 4, ... N workers and report how
+//                  throughput scales
+//   --compare-amp  run --steps in fp32 and in bf16 from the same seed and
+//                  print step time and loss side by side
+//   --profile      per-stage calls/s and latency percentiles every 1000 steps
+//   --trace f      also write every timed stage to a Chrome/Perfetto trace
+//   --sampler      random: uniform permutation per epoch; block: shuffled
+//                  blocks of contiguous frames, so video decoding stays local
+//   --features f   freeze the CNN backbone and train the transformer on its
+//                  cached tokens (see build_feature_store); the store is
+//                  (re)built first when missing or when the backbone, hidden
+//                  size or dataset no longer match it
+//   --backbone c   start the convolutions from a saved policy checkpoint
+struct TrainOptions {
+    int workers = 1;
+    int steps = 100000;
+    bool bf16 = false;
+    bool scaling = false;
+    bool compare_amp = false;
+    bool profile = false;
+    std::string trace;
+    bool block_sampler = false;
+    uint64_t seed = 0;
+    std::string features;
+    bool features_fp16 = false;
+    std::string backbone;
+};
+
+static TrainOptions parse_args(int argc, char** argv) {
+    TrainOptions o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--scaling") {
+            o.scaling = true;
+            continue;
+        }
+        if (arg == "--compare-amp") {
+            o.compare_amp = true;
+            continue;
+        }
+        if (arg == "--profile") {
+            o.profile = true;
+            continue;
+        }
+        if (arg == "--features-fp16") {
+            o.features_fp16 = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+        std::string v = argv[++i];
+        if (arg == "--workers") o.workers = std::stoi(v);
+        else if (arg == "--steps") o.steps = std::stoi(v);
+        else if (arg == "--trace") o.trace = v;
+        else if (arg == "--seed") o.seed = std::stoull(v);
+        else if (arg == "--features") o.features = v;
+        else if (arg == "--backbone") o.backbone = v;
+        else if (arg == "--sampler") {
+            if (v != "random" && v != "block") throw std::invalid_argument("--sampler must be random or block, got " + v);
+            o.block_sampler = v == "block";
+        }
+        else if (arg == "--amp") {
+            if (v != "fp32" && v != "bf16") throw std::invalid_argument("--amp must be fp32 or bf16, got " + v);
+            o.bf16 = v == "bf16";
+        } else throw std::invalid_argument("Unknown argument " + arg);
+    }
+    return o;
+}
+
+static const char* SCALING_LOG = "checkpoints/scaling.jsonl";
+
+// Parent process of --scaling: one run per worker count, then the table
+static int run_scaling(const TrainOptions& o, char** argv) {
+    fs::remove(SCALING_LOG);
+    ::setenv("LEROBOT_SCALING_LOG", SCALING_LOG, 1);
+    std::vector<int> counts;  // powers of two, then the requested count itself
+    for (int w = 1; w < o.workers; w *= 2) counts.push_back(w);
+    counts.push_back(o.workers);
+    for (int w : counts) {
+        std::cout << "=== " << w << " worker(s) ===\n";
+        if (int rc = launch_workers(w, argv)) return rc;
+    }
+
+    std::ifstream f(SCALING_LOG);
+    double base = 0.0;
+    std::cout << "\nworkers  samples/s  speedup  efficiency\n" << std::fixed << std::setprecision(2);
+    for (std::string line; std::getline(f, line);) {
+        auto j = nlohmann::json::parse(line);
+        int w = j["workers"].get<int>();
+        double sps = j["samples_per_s"].get<double>();
+        if (w == 1) base = sps;
+        double speedup = base > 0 ? sps / base : 0.0;
+        std::cout << std::setw(7) << w << std::setw(11) << sps << std::setw(9) << speedup
+                  << std::setw(11) << speedup / w << "\n";
+    }
+    return 0;
+}
+
+static const char* CURVE_LOG = "checkpoints/curve_%s.jsonl";
+
+// Parent process of --compare-amp: the same run in both precisions (later
+// --amp flags override earlier ones), then their curves side by side
+static int run_compare_amp(const TrainOptions& o, int argc, char** argv) {
+    std::map<std::string, std::vector<nlohmann::json>> curves;
+    for (std::string amp : {"fp32", "bf16"}) {
+        char path[64];
+        std::snprintf(path, sizeof(path), CURVE_LOG, amp.c_str());
+        fs::remove(path);
+        ::setenv("LEROBOT_CURVE_LOG", path, 1);
+        std::vector<char*> args(argv, argv + argc);
+        args.push_back(const_cast<char*>("--amp"));
+        args.push_back(amp.data());
+        args.push_back(nullptr);
+        std::cout << "=== " << amp << " ===\n";
+        if (int rc = launch_workers(o.workers, args.data())) return rc;
+
+        std::ifstream f(path);
+        for (std::string line; std::getline(f, line);) curves[amp].push_back(nlohmann::json::parse(line));
+    }
+
+    const auto& a = curves["fp32"];
+    const auto& b = curves["bf16"];
+    std::cout << "\n  step  fp32 ms/step  bf16 ms/step  speedup   fp32 loss   bf16 loss\n" << std::fixed;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i) {
+        double ms_a = a[i]["step_ms"].get<double>(), ms_b = b[i]["step_ms"].get<double>();
+        std::cout << std::setw(6) << a[i]["step"].get<int>() << std::setprecision(2) << std::setw(14) << ms_a
+                  << std::setw(14) << ms_b << std::setw(9) << ms_a / ms_b << std::setprecision(5)
+                  << std::setw(12) << a[i]["loss"].get<double>() << std::setw(12) << b[i]["loss"].get<double>()
+                  << "\n";
+    }
+    return 0;
+}
+
+static int run_worker(const TrainOptions& o) {
+    DistributedContext ctx = init_distributed();
+    std::ostream null_stream(nullptr);
+    std::ostream& log = ctx.is_main() ? std::cout : null_stream;  // rank 0 reports for everyone
+    if (ctx.is_main() && (o.profile || !o.trace.empty())) {
+        Profiler::name_thread("train");
+        if (!o.trace.empty()) Profiler::open_trace(o.trace);
+        Profiler::set_enabled(true);
+    }
+
+    // split the cores between ranks: intra-op threads + loader workers
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    const int cores_per_rank = std::max(1, cores / ctx.world_size);
+    torch::set_num_threads(cores_per_rank);
+    if (ctx.is_main()) fs::create_directories("checkpoints");
+
+    // ACT chunk: the next chunk_size actions, one per frame at the dataset's fps
+    const int chunk_size = 16;
+    double fps = 10.0;  // Push-T
+    if (std::ifstream info("data/pusht/meta/info.json"); info) {
+        auto meta = nlohmann::json::parse(info);
+        fps = meta.value("fps", fps);
+    }
+    std::vector<float> action_deltas;
+    for (int i = 0; i < chunk_size; ++i) action_deltas.push_back(i / fps);
+
+    // image history: the previous frame and the current one
     std::map<std::string, std::vector<float>> deltas{
-        {"observation.image", {-0.033f, 0.0f}}
+        {"observation.image", {-1.0f / float(fps), 0.0f}},
+        {"action", action_deltas}
     };
 
     LeRobotDataset dataset("data/pusht", deltas, "observation.state", "action");
-    dataset.print_all_column_names();
-    std::cout << "Dataset loaded: " << dataset.size().value() << " frames\n";
+    if (ctx.is_main()) dataset.print_all_column_names();
+    log << "Dataset loaded: " << dataset.size().value() << " frames\n";
 
     auto action_mean = dataset.get_action_mean().clone();
     auto action_std  = dataset.get_action_std().clone();
     auto state_mean  = dataset.get_state_mean().clone();
     auto state_std   = dataset.get_state_std().clone();
 
-    std::cout << "State mean: " << state_mean << " std: " << state_std << "\n";
-    std::cout << "Action mean: " << action_mean << " std: " << action_std << "\n";
+    log << "State mean: " << state_mean << " std: " << state_std << "\n";
+    log << "Action mean: " << action_mean << " std: " << action_std << "\n";
 
     int state_dim  = dataset.get_state_mean().size(0);
     int action_dim = dataset.get_action_mean().size(0);
     int hidden_dim = 256;
 
-    std::cout << "Using state_dim=" << state_dim 
-              << " action_dim=" << action_dim 
-              << " hidden_dim=" << hidden_dim << "\n";
+    log << "Using state_dim=" << state_dim
+        << " action_dim=" << action_dim
+        << " hidden_dim=" << hidden_dim << " chunk_size=" << chunk_size << "\n";
 
-    ACTPolicy policy(state_dim, action_dim, hidden_dim);
+    // Hold out the last 10% of episodes (at least one) for evaluation;
+    // episodes are contiguous, so training samples a prefix of the frames
+    const size_t episodes = dataset.num_episodes();
+    const size_t holdout = episodes > 1 ? std::max<size_t>(1, episodes / 10) : 0;
+    const size_t train_episodes = episodes - holdout;
+    const size_t train_frames = holdout ? dataset.episode_range(train_episodes).first : dataset.size().value();
+    log << "Training on " << train_episodes << " episodes (" << train_frames << " frames), "
+        << holdout << " held out\n";
+
+    // This rank's shard: whole episodes where there are enough, frames otherwise
+    size_t shard_first, shard_end;
+    const size_t r = ctx.rank, W = ctx.world_size;
+    if (train_episodes >= W) {
+        shard_first = dataset.episode_range(r * train_episodes / W).first;
+        shard_end = (r + 1) * train_episodes / W < train_episodes
+                        ? dataset.episode_range((r + 1) * train_episodes / W).first
+                        : train_frames;
+    } else {
+        shard_first = r * train_frames / W;
+        shard_end = (r + 1) * train_frames / W;
+    }
+    if (W > 1)
+        std::cout << "[rank " << r << "/" << W << "] shard frames " << shard_first << ".." << shard_end << "\n";
+
+    ACTConfig config;
+    config.state_dim = state_dim;
+    config.action_dim = action_dim;
+    config.hidden_dim = hidden_dim;
+    config.chunk_size = chunk_size;
+    config.image_deltas = dataset.image_deltas();
+    config.action_deltas = action_deltas;
+    config.train_frames = train_frames;
+    config.state_mean = state_mean;
+    config.state_std = state_std;
+    config.action_mean = action_mean;
+    config.action_std = action_std;
+    if (ctx.is_main()) config.save("checkpoints/act_config.json");  // shapes + norm stats for infer
+
+    torch::manual_seed(0);
+    ACTPolicy policy = config.make_policy();
     policy->to(torch::kCPU);
+    if (!o.backbone.empty()) {
+        policy->load_backbone(o.backbone);
+        log << "Backbone from " << o.backbone << "\n";
+    }
+    {
+        torch::NoGradGuard no_grad;
+        ctx.broadcast(policy->parameters());  // every rank starts from rank 0's weights
+    }
+
+    // Cached backbone tokens: the store holds this backbone's output, so it
+    // stays frozen (before the bucketer, which skips frozen parameters)
+    std::unique_ptr<FeatureStore> features;
+    if (!o.features.empty()) {
+        for (auto& p : policy->backbone_parameters()) p.requires_grad_(false);
+        if (ctx.is_main()) {
+            auto reason = FeatureStore::stale_reason(o.features, dataset, policy, o.features_fp16);
+            if (!reason.empty()) {
+                log << "Feature store " << o.features << ": " << reason << ", rebuilding\n";
+                FeatureStore::build(dataset, policy, o.features, o.features_fp16);
+            }
+        }
+        ctx.barrier();  // other ranks open it once rank 0 is done
+        features = std::make_unique<FeatureStore>(o.features);
+        dataset.set_load_images(false);  // the loader gathers rows only
+        log << "Cached features: " << o.features << " (" << (features->fp16() ? "fp16" : "fp32")
+            << "), backbone frozen\n";
+    }
+    GradientBucketer bucketer(ctx, policy->parameters());
+    if (W > 1) log << "Data parallel: " << W << " ranks, " << bucketer.num_buckets() << " gradient buckets\n";
 
     torch::optim::Adam optimizer(policy->parameters(), 1e-4);
 
+    // Prefetch on all but one of this rank's cores; batch_size 1 keeps
+    // single-sample SGD per rank, the policy itself takes any batch size
+    DataLoaderOptions loader_opts;
+    loader_opts.batch_size = 1;
+    loader_opts.num_workers = std::max(2, cores_per_rank) - 1;
+    loader_opts.prefetch = 2 * loader_opts.num_workers;
+    // episode starts inside this rank's shard, relative to its first frame
+    std::vector<size_t> shard_starts{0};
+    for (size_t e = 0; e < episodes; ++e) {
+        const size_t first = dataset.episode_range(e).first;
+        if (first > shard_first && first < shard_end) shard_starts.push_back(first - shard_first);
+    }
+    const size_t shard_size = shard_end - shard_first;
+    const uint64_t seed = (o.seed << 16) + r;  // distinct per rank, reproducible per --seed
+    std::shared_ptr<Sampler> base;
+    if (o.block_sampler) base = std::make_shared<BlockShuffleSampler>(shard_size, shard_starts, seed);
+    else base = std::make_shared<RandomSampler>(shard_size, seed);
+    auto sampler = std::make_shared<RangeSampler>(base, shard_first);
+    log << "Sampler: " << (o.block_sampler ? "block shuffle" : "random") << ", mean seek distance "
+        << mean_seek_distance(*base, shard_starts) << " frames (uniform random: "
+        << mean_seek_distance(RandomSampler(shard_size, seed), shard_starts) << ")\n";
+    DataLoader loader(dataset, sampler, loader_opts);
+    log << "DataLoader: " << loader_opts.num_workers << " workers per rank\n";
+    log << "Precision: " << (o.bf16 ? "bf16 autocast, fp32 master weights" : "fp32") << "\n";
+    const char* curve_path = ctx.is_main() ? std::getenv("LEROBOT_CURVE_LOG") : nullptr;
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(Clock::now() - start).count(); };
+    int64_t samples = 0;
+    double interval_start = 0.0, interval_loss = 0.0;
+
     float total_loss = 0.0f;
     int log_interval = 10000;
-    for (int step = 1; step <= 100000; ++step) {
-        size_t idx = std::rand() % dataset.size().value();
-        auto f = dataset.get(idx);
-
-	// std::cout << "DEBUG FRAME " << idx << ":\n"
-	// 	  << "  state raw = " << f.state << "\n"
-	// 	  << "  action raw = " << f.action << "\n"
-	// 	  << "  state norm = " << (f.state - state_mean) / (state_std + 1e-8) << "\n"
-	// 	  << "  action norm = " << (f.action - action_mean) / (action_std + 1e-8) << "\n";
-	// if (!f.images.empty()) {
-	//   auto& img = f.images.begin()->second;
-	//   std::cout << "  image size = " << img.size() << " type=" << img.type() << "\n";
-	// }
-
-        std::vector<cv::Mat> imgs;
-        auto it = f.images.find(-0.066f);
-	if (it != f.images.end()) imgs.push_back(it->second);
-	it = f.images.find(0.0f);
-	if (it != f.images.end()) imgs.push_back(it->second);
-
-        // Fallback: 96x96 gray images (Push-T resolution)
-        if (imgs.empty()) {
-            imgs.emplace_back(96, 96, CV_8UC3, cv::Scalar(128,128,128));
+    for (int step = 1; step <= o.steps; ++step) {
+        PROFILE_SCOPE("train.step");
+        Batch batch;
+        {
+            PROFILE_SCOPE("train.load_batch");  // wait for the loader
+            batch = loader.next();
         }
-        if (imgs.size() == 1) {
-            imgs.emplace_back(96, 96, CV_8UC3, cv::Scalar(128,128,128));
+        auto state  = batch.state;   // [B, state_dim]
+
+        // Fallback: 96x96 gray history (Push-T resolution), all frames real
+        auto images = batch.images;
+        auto image_mask = batch.image_mask;
+        if (!images.defined() && !features) {
+            images = torch::full({state.size(0), 2, 3, 96, 96}, 128, torch::kUInt8);
+            image_mask = torch::ones({state.size(0), 2}, torch::kBool);
         }
 
-        auto norm_state  = (f.state  - state_mean)  / (state_std  + 1e-5);
-        auto norm_action = (f.action - action_mean) / (action_std + 1e-5);
+        auto norm_state  = (state  - state_mean)  / (state_std  + 1e-5);
+        auto norm_chunk = (batch.action_chunk - action_mean) / (action_std + 1e-5);
 
-        auto pred = policy->forward(imgs, norm_state);
-        auto loss = torch::mse_loss(pred, norm_action);
+        torch::Tensor pred;  // [B, chunk_size, action_dim]
+        {
+            PROFILE_SCOPE("train.forward");
+            CpuAutocast autocast(o.bf16);
+            pred = features ? policy->forward_tokens(features->gather(batch.image_rows), norm_state, image_mask)
+                            : policy->forward(images, norm_state, image_mask);
+        }
+        auto loss = chunk_loss(pred, norm_chunk, batch.action_chunk_mask);  // float32
+        samples += state.size(0);
 
 	total_loss += loss.item<float>();
+	interval_loss += loss.item<float>();
 	if (step % 1000 == 0) {
-	    std::cout << "Step: " << step << " | Loss: "  << loss.item<float>() << " | Action pred: " << pred.sizes() << "\n";
+	    double mean_loss = ctx.sum(loss.item<float>()) / W;  // collective: every rank calls it
+	    double throughput = ctx.sum(samples) / elapsed();
+	    if (curve_path) {
+	        const double now = elapsed();
+	        std::ofstream f(curve_path, std::ios::app);
+	        f << nlohmann::json{{"step", step}, {"loss", interval_loss / 1000},
+	                            {"step_ms", now - interval_start}}.dump() << "\n";  // s per 1000 steps = ms per step
+	        interval_start = now;
+	    }
+	    interval_loss = 0.0;
+	    auto ls = loader.stats();
+	    log << "Step: " << step << " | Loss: "  << mean_loss << " | Action pred: " << pred.sizes()
+	        << " | " << throughput << " samples/s | t=" << elapsed() << "s"
+	        << " | Loader wait: " << ls.consumer_wait_s << "s / " << ls.batches << " batches\n";
+	    auto cs = dataset.frame_cache_stats();
+	    log << "  Frame cache: " << cs.hits << " hits, " << cs.misses << " misses, "
+	        << cs.evictions << " evictions, " << (cs.bytes >> 20) << " MiB\n";
+	    auto ps = dataset.decoder_pool_stats();
+	    log << "  Decoders: " << ps.open << " open, " << ps.seeks << " seeks / "
+	        << ps.reads << " reads, mean seek distance "
+	        << double(ps.seek_distance) / std::max<uint64_t>(1, ps.reads) << " frames\n";
+	    if (Profiler::enabled()) Profiler::report(log);
 	}
         if (step % log_interval == 0) {
-	    std::cout << "Avg Loss: " << (total_loss / log_interval) << "\n";
+	    log << "Avg Loss: " << (total_loss / log_interval) << "\n";
 	    total_loss = 0.0f;
-            torch::save(policy, "checkpoints/act_step" + std::to_string(step) + ".pt");
+	    if (ctx.is_main()) {
+	        PROFILE_SCOPE("train.checkpoint");
+	        torch::save(policy, "checkpoints/act_step" + std::to_string(step) + ".pt");
+	    }
 	}
 
         optimizer.zero_grad();
-        loss.backward();
-        torch::nn::utils::clip_grad_norm_(policy->parameters(), 1.0);
-        optimizer.step();
+        {
+            PROFILE_SCOPE("train.backward");
+            loss.backward();
+        }
+        {
+            PROFILE_SCOPE("train.allreduce");
+            bucketer.finish();  // gradients averaged over ranks
+        }
+        {
+            PROFILE_SCOPE("train.clip_grad");
+            torch::nn::utils::clip_grad_norm_(policy->parameters(), 1.0);
+        }
+        {
+            PROFILE_SCOPE("train.optimizer");
+            optimizer.step();
+        }
 
     }
 
-    torch::save(policy, "checkpoints/act_final.pt");
-    std::cout << "Training complete! Model saved to checkpoints/act_final.pt\n";
+    const double throughput = ctx.sum(samples) / elapsed();
+    log << "Throughput: " << throughput << " samples/s over " << W << " rank(s), "
+        << throughput / W << " per rank\n";
+    if (const char* path = std::getenv("LEROBOT_SCALING_LOG"); path && ctx.is_main()) {
+        std::ofstream f(path, std::ios::app);
+        f << nlohmann::json{{"workers", W}, {"samples_per_s", throughput}, {"seconds", elapsed()}}.dump() << "\n";
+    }
+
+    if (ctx.is_main()) {
+        torch::save(policy, "checkpoints/act_final.pt");
+        std::cout << "Training complete! Model saved to checkpoints/act_final.pt\n";
+    }
+    Profiler::close_trace();
+    ctx.barrier();
     return 0;
 }
+
+int main(int argc, char** argv) {
+    TrainOptions o;
+    try {
+        o = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    const bool is_worker = std::getenv("LEROBOT_RANK") != nullptr;
+    if (!is_worker && o.compare_amp) return run_compare_amp(o, argc, argv);
+    if (!is_worker && o.scaling) return run_scaling(o, argv);
+    if (!is_worker && o.workers > 1) return launch_workers(o.workers, argv);
+    return run_worker(o);
+}
@@ -0,0 +1,236 @@
+#include "video_decoder.h"
+#include "parallel.h"
+#include <cstdlib>
+#include <iostream>
+
+VideoDecoder::VideoDecoder(const std::string& path, int max_forward)
+    : path_(path), cap_(path), max_forward_(max_forward) {}
+
+cv::Mat VideoDecoder::read(int frame_idx) {
+    cv::Mat frame;
+    if (!cap_.isOpened() || frame_idx < 0) return frame;
+    ++stats_.reads;
+
+    int ahead = frame_idx - next_frame_;
+    stats_.distance += std::abs(ahead);
+    if (ahead < 0 || ahead > max_forward_) {
+        cap_.set(cv::CAP_PROP_POS_FRAMES, frame_idx);
+        ++stats_.seeks;
+    } else {
+        // grab() decodes without the colour conversion of retrieve()
+        for (; ahead > 0; --ahead) {
+            if (!cap_.grab()) {
+                next_frame_ = frame_idx;  // past the end; force a seek next time
+                return frame;
+            }
+            ++stats_.skipped;
+        }
+    }
+    cap_ >> frame;
+    next_frame_ = frame_idx + 1;
+    return frame;
+}
+
+// --- FrameCache ---
+
+static size_t mat_bytes(const cv::Mat& m) { return m.total() * m.elemSize(); }
+
+bool FrameCache::get(const std::string& video, int frame_idx, cv::Mat& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(Key{video, frame_idx});
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->second;
+    ++stats_.hits;
+    return true;
+}
+
+void FrameCache::put(const std::string& video, int frame_idx, const cv::Mat& frame) {
+    if (frame.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);  // set_capacity() may shrink capacity_bytes_ concurrently
+    if (mat_bytes(frame) > capacity_bytes_) return;
+    Key key{video, frame_idx};
+    if (index_.count(key)) return;  // another reader decoded it first
+
+    evict_to(capacity_bytes_ - mat_bytes(frame));
+    lru_.emplace_front(key, frame);
+    index_.emplace(std::move(key), lru_.begin());
+    stats_.bytes += mat_bytes(frame);
+    stats_.entries = lru_.size();
+}
+
+void FrameCache::set_capacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_bytes_ = bytes;
+    evict_to(bytes);
+}
+
+void FrameCache::evict_to(size_t bytes) {
+    while (stats_.bytes > bytes && !lru_.empty()) {
+        const auto& victim = lru_.back();
+        stats_.bytes -= mat_bytes(victim.second);
+        index_.erase(victim.first);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+    stats_.entries = lru_.size();
+}
+
+FrameCacheStats FrameCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// --- DecoderPool ---
+
+DecoderPool::Lease& DecoderPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (decoder_) pool_->release(std::move(decoder_));
+        pool_ = other.pool_;
+        decoder_ = std::move(other.decoder_);
+    }
+    return *this;
+}
+
+DecoderPool::Lease::~Lease() {
+    if (decoder_) pool_->release(std::move(decoder_));
+}
+
+DecoderPool::Lease DecoderPool::acquire(const std::string& path, int frame_idx) {
+    std::vector<std::unique_ptr<VideoDecoder>> closed;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_.count(path)) return Lease();
+
+    for (;;) {
+        auto& idle = idle_[path];
+        if (!idle.empty()) {
+            // closest decoder at or before the target, else the least far ahead
+            size_t best = 0;
+            for (size_t i = 1; i < idle.size(); ++i) {
+                int pos = idle[i].decoder->position(), best_pos = idle[best].decoder->position();
+                bool before = pos <= frame_idx, best_before = best_pos <= frame_idx;
+                if (before != best_before ? before : (before ? pos > best_pos : pos < best_pos))
+                    best = i;
+            }
+            auto decoder = std::move(idle[best].decoder);
+            idle.erase(idle.begin() + best);
+            ++stats_.leased;
+            return Lease(this, std::move(decoder));
+        }
+        if (open_ < options_.max_open || close_oldest_idle(closed)) break;
+        ++stats_.waits;
+        cv_.wait(lock);
+    }
+
+    // open outside the lock; the slot is reserved in open_
+    ++open_;
+    lock.unlock();
+    closed.clear();
+    auto decoder = std::make_unique<VideoDecoder>(path, options_.max_forward);
+    lock.lock();
+
+    if (!decoder->is_open()) {
+        --open_;
+        if (failed_.insert(path).second) std::cerr << "Failed to open video: " << path << "\n";
+        cv_.notify_one();
+        return Lease();
+    }
+    ++stats_.opened;
+    ++stats_.leased;
+    return Lease(this, std::move(decoder));
+}
+
+void DecoderPool::warm(const std::vector<std::string>& paths) {
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        n = std::min(paths.size(), options_.max_open - std::min(open_, options_.max_open));
+        open_ += n;  // reserve
+    }
+    std::vector<std::unique_ptr<VideoDecoder>> opened(n);
+    parallel_for(n, [&](size_t i) {
+        opened[i] = std::make_unique<VideoDecoder>(paths[i], options_.max_forward);
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    for (auto& decoder : opened) {
+        if (!decoder->is_open()) {
+            --open_;
+            if (failed_.insert(decoder->path()).second)
+                std::cerr << "Failed to open video: " << decoder->path() << "\n";
+            continue;
+        }
+        ++stats_.opened;
+        auto& idle = idle_[decoder->path()];
+        idle.push_back({std::move(decoder), now});
+    }
+    cv_.notify_all();
+}
+
+void DecoderPool::release(std::unique_ptr<VideoDecoder> decoder) {
+    std::vector<std::unique_ptr<VideoDecoder>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        stats_.seeks += decoder->stats().seeks;
+        stats_.reads += decoder->stats().reads;
+        stats_.seek_distance += decoder->stats().distance;
+        decoder->reset_stats();
+        --stats_.leased;
+        auto& idle = idle_[decoder->path()];
+        idle.push_back({std::move(decoder), now});
+        collect_expired(now, expired);
+    }
+    cv_.notify_one();
+}
+
+void DecoderPool::reclaim_idle() {
+    std::vector<std::unique_ptr<VideoDecoder>> expired;
+    std::lock_guard<std::mutex> lock(mutex_);
+    collect_expired(Clock::now(), expired);
+}
+
+bool DecoderPool::close_oldest_idle(std::vector<std::unique_ptr<VideoDecoder>>& out) {
+    std::vector<Idle>* oldest_list = nullptr;
+    size_t oldest = 0;
+    for (auto& [path, idle] : idle_)
+        for (size_t i = 0; i < idle.size(); ++i)
+            if (!oldest_list || idle[i].since < (*oldest_list)[oldest].since) {
+                oldest_list = &idle;
+                oldest = i;
+            }
+    if (!oldest_list) return false;
+    out.push_back(std::move((*oldest_list)[oldest].decoder));
+    oldest_list->erase(oldest_list->begin() + oldest);
+    --open_;
+    ++stats_.reclaimed;
+    return true;
+}
+
+void DecoderPool::collect_expired(Clock::time_point now,
+                                  std::vector<std::unique_ptr<VideoDecoder>>& out) {
+    auto max_idle = std::chrono::duration<double>(options_.idle_seconds);
+    for (auto& [path, idle] : idle_) {
+        for (auto it = idle.begin(); it != idle.end();) {
+            if (now - it->since > max_idle) {
+                out.push_back(std::move(it->decoder));
+                it = idle.erase(it);
+                --open_;
+                ++stats_.reclaimed;
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+DecoderPoolStats DecoderPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DecoderPoolStats s = stats_;
+    s.open = open_;
+    return s;
+}
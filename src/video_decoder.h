@@ -0,0 +1,157 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// One open video stream that remembers where it is. Targets at or shortly
+// after the current position are reached by decoding forward; only targets
+// behind it or more than max_forward frames ahead pay for a seek (which
+// rewinds to a keyframe and re-decodes up to the target).
+class VideoDecoder {
+public:
+    struct Stats {
+        uint64_t reads = 0;
+        uint64_t seeks = 0;
+        uint64_t skipped = 0;  // frames decoded forward and dropped
+        uint64_t distance = 0; // sum over reads of |target - position|, in frames
+    };
+
+    explicit VideoDecoder(const std::string& path, int max_forward = 32);
+
+    bool is_open() const { return cap_.isOpened(); }
+    const std::string& path() const { return path_; }
+    int position() const { return next_frame_; }  // index the next sequential read returns
+    cv::Mat read(int frame_idx);
+    const Stats& stats() const { return stats_; }
+    void reset_stats() { stats_ = Stats(); }
+
+private:
+    std::string path_;
+    cv::VideoCapture cap_;
+    int max_forward_;
+    int next_frame_ = 0;
+    Stats stats_;
+};
+
+struct FrameCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t bytes = 0;
+    size_t entries = 0;
+};
+
+// LRU of decoded frames keyed by (video, frame index), bounded by the total
+// bytes of the cached Mats. Returned Mats share the cached buffer: callers
+// must not write into them.
+class FrameCache {
+public:
+    explicit FrameCache(size_t capacity_bytes = size_t(512) << 20)
+        : capacity_bytes_(capacity_bytes) {}
+
+    bool get(const std::string& video, int frame_idx, cv::Mat& out);
+    void put(const std::string& video, int frame_idx, const cv::Mat& frame);
+    void set_capacity(size_t bytes);
+    FrameCacheStats stats() const;
+
+private:
+    struct Key {
+        std::string video;
+        int frame;
+        bool operator==(const Key& o) const { return frame == o.frame && video == o.video; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<std::string>()(k.video) ^ (std::hash<int>()(k.frame) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+    using Entry = std::pair<Key, cv::Mat>;
+
+    size_t capacity_bytes_;
+    std::list<Entry> lru_;  // front = most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    FrameCacheStats stats_;
+    mutable std::mutex mutex_;
+
+    void evict_to(size_t bytes);  // caller holds mutex_
+};
+
+struct DecoderPoolOptions {
+    size_t max_open = 64;        // open decoders across all videos
+    double idle_seconds = 30.0;  // idle decoders older than this are closed
+    int max_forward = 32;        // see VideoDecoder
+};
+
+struct DecoderPoolStats {
+    size_t open = 0;
+    size_t leased = 0;
+    uint64_t opened = 0;
+    uint64_t reclaimed = 0;  // closed for idleness or to make room under max_open
+    uint64_t waits = 0;      // acquire() blocked because every decoder was leased
+    uint64_t seeks = 0;      // VideoDecoder stats of returned leases
+    uint64_t reads = 0;
+    uint64_t seek_distance = 0;  // frames, see VideoDecoder::Stats::distance
+};
+
+// Hands out exclusive VideoDecoder leases so concurrent get() calls decode
+// in parallel. The pool mutex only guards bookkeeping; decoding happens on
+// the leased handle outside it. Decoders open lazily, several may exist per
+// video (one per concurrent reader), and acquire() prefers the idle decoder
+// positioned just before the target so sequential readers keep streaming.
+class DecoderPool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(DecoderPool* pool, std::unique_ptr<VideoDecoder> decoder)
+            : pool_(pool), decoder_(std::move(decoder)) {}
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        explicit operator bool() const { return decoder_ != nullptr; }
+        VideoDecoder* operator->() const { return decoder_.get(); }
+        VideoDecoder& operator*() const { return *decoder_; }
+
+    private:
+        DecoderPool* pool_ = nullptr;
+        std::unique_ptr<VideoDecoder> decoder_;
+    };
+
+    explicit DecoderPool(DecoderPoolOptions options = {}) : options_(options) {}
+
+    Lease acquire(const std::string& path, int frame_idx);  // empty if the file won't open
+    // Open one idle decoder per path (up to max_open) concurrently
+    void warm(const std::vector<std::string>& paths);
+    void reclaim_idle();
+    DecoderPoolStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Idle {
+        std::unique_ptr<VideoDecoder> decoder;
+        Clock::time_point since;
+    };
+
+    DecoderPoolOptions options_;
+    std::unordered_map<std::string, std::vector<Idle>> idle_;
+    std::unordered_set<std::string> failed_;  // paths that did not open, warned once
+    size_t open_ = 0;                          // idle + leased + being opened
+    DecoderPoolStats stats_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    void release(std::unique_ptr<VideoDecoder> decoder);
+    // the following expect mutex_ held; closed decoders are moved to `out`
+    // so they are destroyed after the lock is dropped
+    bool close_oldest_idle(std::vector<std::unique_ptr<VideoDecoder>>& out);
+    void collect_expired(Clock::time_point now, std::vector<std::unique_ptr<VideoDecoder>>& out);
+};